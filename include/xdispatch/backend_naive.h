@@ -29,6 +29,8 @@
 
 #include "xdispatch/dispatch.h"
 #include "xdispatch/backend_naive_ithreadpool.h"
+#include "xdispatch/backend_naive_threadpool.h"
+#include "xdispatch/backend_naive_io.h"
 #if (!BUILD_XDISPATCH2_BACKEND_NAIVE)
     #error "The naive backend is not available on this platform"
 #endif
@@ -36,6 +38,17 @@
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
+/**
+    @return A new threadpool isolated from the global threadpool
+
+    Use create_parallel_queue() and create_serial_queue() to create
+    queues executing their operations on the threadpool.
+
+    @param config The configuration of the threadpool
+    */
+XDISPATCH_EXPORT ithreadpool_ptr
+create_threadpool(const threadpool_config& config);
+
 /**
     @return A new serial queue powered by the given thread
 
@@ -50,6 +63,56 @@ create_serial_queue(const std::string& label,
                     const ithreadpool_ptr& thread,
                     queue_priority priority = queue_priority::DEFAULT);
 
+/**
+    @brief Limits how long a serial queue may occupy a thread of its
+           threadpool before yielding it to other work
+
+    Whatever limit is hit first ends the drain. The number of operations
+    executed per drain is adapted continuously so that it matches the time
+    given here for the operations seen most recently.
+ */
+struct serial_queue_drain_budget
+{
+    /// the time after which a queue yields its thread
+    std::chrono::microseconds duration{ 200 };
+    /// the maximum number of operations executed before yielding
+    size_t operations = 1000;
+};
+
+/**
+    @brief Statistics on the way a serial queue shares its thread
+ */
+struct serial_queue_statistics
+{
+    /// the number of operations currently executed before yielding
+    size_t operations_per_drain = 0;
+    /// the number of times the queue started draining operations
+    uint64_t drains = 0;
+    /// the number of times the queue yielded with operations left
+    uint64_t yields = 0;
+};
+
+/**
+    @brief Changes the budget of a serial queue created by the naive backend
+
+    @param q The queue to change, other kinds of queues are ignored
+    @param budget The budget to use from now on
+ */
+XDISPATCH_EXPORT void
+drain_budget(const queue& q, const serial_queue_drain_budget& budget);
+
+/**
+    @return The budget of a serial queue created by the naive backend
+ */
+XDISPATCH_EXPORT serial_queue_drain_budget
+drain_budget(const queue& q);
+
+/**
+    @return The statistics of a serial queue created by the naive backend
+ */
+XDISPATCH_EXPORT serial_queue_statistics
+statistics(const queue& q);
+
 /**
     @return A new parallel queue powered by the given pool
 
@@ -63,6 +126,40 @@ create_parallel_queue(const std::string& label,
                       const ithreadpool_ptr& pool,
                       queue_priority priority = queue_priority::DEFAULT);
 
+/**
+    @brief Controls how a socket notifier reports the readiness of its socket
+ */
+enum class notifier_trigger
+{
+    /// the handler is invoked again for as long as the socket stays ready
+    LEVEL,
+    /// the handler is invoked whenever the socket becomes ready and
+    /// needs to service the socket until the operation would block
+    EDGE
+};
+
+/**
+    @return A new socket notifier using the given trigger mode
+
+    Notifiers constructed directly are level-triggered. Edge-triggered
+    notifiers avoid that the readiness has to be evaluated anew after
+    each handler invocation but the handler has to read or write until
+    the socket reports EAGAIN. Platforms without support for edge-triggered
+    notifications will fall back to level-triggered notifiers.
+
+    @param socket The socket to be monitored
+    @param type The type of operation to monitor the socket for
+    @param trigger The way readiness of the socket is reported
+    @param target The queue to execute the handler on
+
+    @throws std::logic_error if target is not powered by the naive backend
+    */
+XDISPATCH_EXPORT socket_notifier
+create_socket_notifier(socket_t socket,
+                       notifier_type type,
+                       notifier_trigger trigger,
+                       const queue& target = global_queue());
+
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
 
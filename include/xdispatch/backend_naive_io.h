@@ -0,0 +1,198 @@
+/*
+ * backend_naive_io.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_IO_PUBLIC_H_
+#define XDISPATCH_NAIVE_IO_PUBLIC_H_
+
+/**
+ * @addtogroup xdispatch
+ * @{
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "xdispatch/dispatch.h"
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief The outcome of an asynchronous I/O request
+ */
+struct io_result
+{
+    /// the number of bytes transferred or the socket accepted
+    int64_t value = 0;
+    /// the error the request failed with or zero on success
+    int error = 0;
+};
+
+/**
+    @brief The operation executed once an I/O request completed
+ */
+using io_operation = parameterized_operation<io_result>;
+
+using io_operation_ptr = std::shared_ptr<io_operation>;
+
+/**
+    @brief Memory to be used with async_read() and async_write()
+
+    Buffers are taken from memory registered with the kernel upfront
+    whenever possible, this saves the kernel from mapping the pages for
+    every single request. Larger buffers or buffers requested while all
+    registered memory is in use are allocated from the heap instead.
+ */
+class XDISPATCH_EXPORT io_buffer
+{
+public:
+    /**
+        @brief Constructs a buffer holding at least size bytes
+     */
+    explicit io_buffer(size_t size);
+
+    io_buffer(const io_buffer&) = delete;
+
+    ~io_buffer();
+
+    io_buffer& operator=(const io_buffer&) = delete;
+
+    /**
+        @return The memory held by the buffer
+     */
+    char* data() const { return m_data; }
+
+    /**
+        @return The number of bytes held by the buffer
+     */
+    size_t size() const { return m_size; }
+
+    /**
+        @return true if the buffer is registered with the kernel
+     */
+    bool registered() const { return m_index >= 0; }
+
+private:
+    char* m_data;
+    size_t m_size;
+    int m_index;
+};
+
+/**
+    @brief Reads up to size bytes from the socket into buffer
+
+    Returns immediately and executes the completion on the target queue
+    once data was read. The buffer has to stay valid until then. A value
+    of zero indicates that the peer closed the connection.
+ */
+XDISPATCH_EXPORT void
+async_read(const queue& target,
+           socket_t socket,
+           char* buffer,
+           size_t size,
+           const io_operation_ptr& completion);
+
+/**
+    @copydoc async_read(const queue&, socket_t, char*, size_t,
+                        const io_operation_ptr&)
+ */
+template<typename Func>
+inline void
+async_read(const queue& target,
+           socket_t socket,
+           char* buffer,
+           size_t size,
+           const Func& completion)
+{
+    async_read(target, socket, buffer, size, io_operation::make(completion));
+}
+
+/**
+    @brief Writes up to size bytes from buffer to the socket
+
+    Returns immediately and executes the completion on the target queue
+    once data was written. The buffer has to stay valid until then.
+ */
+XDISPATCH_EXPORT void
+async_write(const queue& target,
+            socket_t socket,
+            const char* buffer,
+            size_t size,
+            const io_operation_ptr& completion);
+
+/**
+    @copydoc async_write(const queue&, socket_t, const char*, size_t,
+                         const io_operation_ptr&)
+ */
+template<typename Func>
+inline void
+async_write(const queue& target,
+            socket_t socket,
+            const char* buffer,
+            size_t size,
+            const Func& completion)
+{
+    async_write(target, socket, buffer, size, io_operation::make(completion));
+}
+
+/**
+    @brief Accepts a connection on the listening socket
+
+    Returns immediately and executes the completion on the target queue
+    once a connection was accepted, passing the new socket as value.
+ */
+XDISPATCH_EXPORT void
+async_accept(const queue& target,
+             socket_t socket,
+             const io_operation_ptr& completion);
+
+/**
+    @copydoc async_accept(const queue&, socket_t, const io_operation_ptr&)
+ */
+template<typename Func>
+inline void
+async_accept(const queue& target, socket_t socket, const Func& completion)
+{
+    async_accept(target, socket, io_operation::make(completion));
+}
+
+/**
+    @brief Enables or disables serving I/O requests using io_uring
+
+    Requests are served using io_uring by default whenever the platform
+    supports it. When disabled or unavailable the socket is waited upon
+    to become ready before the actual call is made.
+ */
+XDISPATCH_EXPORT void
+io_uring_enabled(bool enabled);
+
+/**
+    @return true if I/O requests are served using io_uring
+ */
+XDISPATCH_EXPORT bool
+io_uring_enabled();
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+/** @} */
+
+#endif /* XDISPATCH_NAIVE_IO_PUBLIC_H_ */
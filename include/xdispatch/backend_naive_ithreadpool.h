@@ -29,6 +29,8 @@
 
 #include "xdispatch/dispatch.h"
 
+#include <vector>
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
@@ -60,6 +62,44 @@ public:
     virtual void execute(const operation_ptr& work,
                          queue_priority priority) = 0;
 
+    /**
+        @brief Same as execute(const operation_ptr&, queue_priority) but
+               taking over the given work
+
+        Pools able to queue work without shared ownership should override
+        this, the default implementation moves the work into an operation_ptr.
+     */
+    virtual void execute_unique(unique_operation&& work,
+                                queue_priority priority)
+    {
+        execute(work.share(), priority);
+    }
+
+    /**
+        @brief Same as execute_unique(unique_operation&&, queue_priority)
+               but taking over all of the given work at once
+
+        Pools able to queue many items of work at once should override
+        this, the default implementation queues the work item by item.
+     */
+    virtual void execute_bulk(std::vector<unique_operation>&& work,
+                              queue_priority priority)
+    {
+        for (auto& item : work) {
+            execute_unique(std::move(item), priority);
+        }
+    }
+
+    /**
+        @return true if work has to execute on particular threads of the
+                pool, e.g. the main thread, and must not be executed on any
+                other thread instead
+
+        Pools running work on any of their threads should override this,
+        the default implementation conservatively returns true.
+     */
+    virtual bool thread_bound() const { return true; }
+
     /**
         @brief Returns the threadpool instance currently executing this thread
        or null
@@ -107,6 +147,11 @@ protected:
         @brief Runs the given operation in the scope of the given threadpool
     */
     static void run_with_threadpool(operation&, ithreadpool*);
+
+    /**
+        @copydoc run_with_threadpool(operation&, ithreadpool*)
+    */
+    static void run_with_threadpool(unique_operation&, ithreadpool*);
 };
 
 inline ithreadpool::block_scope::block_scope()
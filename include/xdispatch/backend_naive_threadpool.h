@@ -0,0 +1,378 @@
+/*
+ * backend_naive_threadpool.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_THREADPOOL_PUBLIC_H_
+#define XDISPATCH_NAIVE_THREADPOOL_PUBLIC_H_
+
+/**
+ * @addtogroup xdispatch
+ * @{
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "xdispatch/backend_naive_ithreadpool.h"
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief Statistics on the time operations spent waiting in a bucket
+           of a threadpool before being picked up by a worker
+
+    Only a sample of all operations is measured.
+ */
+struct threadpool_bucket_statistics
+{
+    /// the number of operations measured
+    uint64_t samples = 0;
+    /// the average time waited by the measured operations
+    std::chrono::nanoseconds average_wait{ 0 };
+    /// the longest time waited by any of the measured operations
+    std::chrono::nanoseconds max_wait{ 0 };
+};
+
+/**
+    @brief Statistics on the time it took idle workers of a threadpool
+           to start running after being woken for new work
+ */
+struct threadpool_wake_statistics
+{
+    /// the number of wakeups measured
+    uint64_t samples = 0;
+    /// the average time between waking a worker and it running
+    std::chrono::nanoseconds average_latency{ 0 };
+    /// the longest time between waking a worker and it running
+    std::chrono::nanoseconds max_latency{ 0 };
+};
+
+/**
+    @brief Controls how idle workers of a threadpool wait for new work
+
+    An idle worker first spins checking for new work, then yields its
+    processor a number of times and finally parks until woken. Spinning
+    longer lowers the latency until new work is picked up at the cost of
+    burning processor time while there is none.
+ */
+struct threadpool_park_policy
+{
+    /// the number of times to check for new work while spinning
+    unsigned spins = 1000;
+    /// set to adapt spinning to how soon new work arrived recently,
+    /// spinning less when it was of no use lately and never for longer
+    /// than parking and being woken again takes on average
+    bool adaptive = false;
+    /// the number of times to yield the processor after spinning
+    unsigned yields = 0;
+    /// the time a parked worker waits for new work before it ends
+    std::chrono::milliseconds park_timeout{ 30000 };
+    /// the number of workers kept alive even when parked for longer
+    /// than the park timeout, these are spawned upfront
+    unsigned min_warm_threads = 0;
+};
+
+/**
+    @brief The configuration of a threadpool
+ */
+struct threadpool_config
+{
+    /// set to have each worker queue work submitted from within the
+    /// pool locally, see threadpool
+    bool work_stealing = false;
+    /// the number of threads kept alive even when idle, the larger of
+    /// this and threadpool_park_policy::min_warm_threads is used
+    unsigned min_threads = 0;
+    /// the number of threads running at most unless some of them are
+    /// blocked, zero to use twice the number of processors
+    unsigned max_threads = 0;
+    /// the indices of the processors the threads are bound to, empty
+    /// to have them run on any processor
+    std::vector<int> affinity;
+    /// the policy used by idle workers
+    threadpool_park_policy park_policy;
+    /// set to run a threadpool per NUMA node, see numa_threadpool
+    bool numa = false;
+};
+
+/**
+    An implementation of ithreadpool executing on a dynamic number
+    of worker threads.
+
+    Operations are queued to one of four shared buckets depending on
+    their priority. Workers share their time between the buckets in rounds
+    granting each bucket as many operations as given by its weight. Buckets
+    not served for longer than the aging threshold are preferred regardless
+    of their weight so that all of them see bounded latencies.
+
+    In work stealing mode each worker additionally owns a local deque
+    receiving all work submitted from within the worker itself. Idle workers
+    will steal from the deques of other workers so that fork-join like
+    workloads do not contend on the shared buckets. Local work is not subject
+    to the weights or priorities: a worker serves its own deque ahead of the
+    buckets but checks the buckets at least once every 61 local operations,
+    so work of any priority queued from outside waits for at most that many
+    local operations per worker.
+
+    Idle workers park in a slot of their own. New work wakes the worker
+    which went idle last as it is the most likely to still find its data
+    in the caches of the processor it ran on.
+ */
+class XDISPATCH_EXPORT threadpool : public ithreadpool
+{
+public:
+    enum
+    {
+        bucket_USER_INTERACTIVE = 0,
+        bucket_USER_INITIATED = 1,
+        bucket_UTILITY = 2,
+        bucket_BACKGROUND = 3,
+
+        bucket_count
+    };
+
+    /**
+        @brief The number of operations each bucket may run in a round,
+               indexed by bucket
+     */
+    using bucket_weights = std::array<unsigned, bucket_count>;
+
+    /**
+        @brief Per bucket statistics, indexed by bucket
+     */
+    using bucket_statistics =
+      std::array<threadpool_bucket_statistics, bucket_count>;
+
+    /**
+        @brief Constructor
+
+        @param work_stealing Set to true to have each worker queue
+                             work submitted from within the pool locally
+        @param policy The policy used by idle workers
+     */
+    explicit threadpool(
+      bool work_stealing = false,
+      const threadpool_park_policy& policy = threadpool_park_policy());
+
+    /**
+        @brief Constructs a threadpool using the given configuration
+     */
+    explicit threadpool(const threadpool_config& config);
+
+    /**
+        @brief Destructor
+     */
+    ~threadpool() override;
+
+    /**
+        @copydoc ithreadpool::execute
+     */
+    void execute(const operation_ptr& work, queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::execute_unique
+     */
+    void execute_unique(unique_operation&& work,
+                        queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::execute_bulk
+     */
+    void execute_bulk(std::vector<unique_operation>&& work,
+                      queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::thread_bound
+     */
+    bool thread_bound() const final { return false; }
+
+    /**
+        @brief Changes the weights used to share workers between buckets
+
+        Defaults to 8:4:2:1. A weight of zero causes a bucket to be served
+        only when all other buckets are empty or its operations aged.
+     */
+    void weights(const bucket_weights& weights);
+
+    /**
+        @return the weights used to share workers between buckets
+     */
+    bucket_weights weights() const;
+
+    /**
+        @brief Changes the time after which a bucket not served will
+               be preferred over all other buckets
+
+        Defaults to 50ms
+     */
+    void aging(std::chrono::milliseconds threshold);
+
+    /**
+        @return the time after which a bucket not served will be preferred
+     */
+    std::chrono::milliseconds aging() const;
+
+    /**
+        @brief Changes the policy used by idle workers
+
+        The minimum number of warm threads will not drop below the minimum
+        number of threads the pool was configured with.
+     */
+    void park_policy(const threadpool_park_policy& policy);
+
+    /**
+        @return the policy used by idle workers
+     */
+    threadpool_park_policy park_policy() const;
+
+    /**
+        @return the time operations spent waiting in each bucket
+     */
+    bucket_statistics statistics() const;
+
+    /**
+        @return the time idle workers took to run after being woken
+     */
+    threadpool_wake_statistics wake_statistics() const;
+
+protected:
+    /**
+        @brief Marks a thread as blocked, i.e. waiting on a resource
+
+        Use this to notify the pool that it may spawn additional threads
+        without overallocating the system's processor count as the calling
+        thread is blocking on a resource
+     */
+    void notify_thread_blocked() final;
+
+    /**
+        @brief Marks a thread as unblocked, i.e. busy again
+
+        Use this to notify the pool that a previously blocked thread
+        has obtained its resource and will now make use of CPU resources
+        again.
+     */
+    void notify_thread_unblocked() final;
+
+private:
+    friend class numa_threadpool;
+
+    class worker;
+    class data;
+    using data_ptr = std::shared_ptr<data>;
+
+    void schedule(int count = 1);
+    void spawn_thread();
+    void siblings(const std::vector<std::shared_ptr<threadpool>>& pools);
+
+    data_ptr m_data;
+};
+
+/**
+    An implementation of ithreadpool running a threadpool per NUMA node
+
+    The workers of each node are bound to the processors of the node.
+    Work submitted from a processor of a node is executed on that node so
+    that it will find its data in memory local to the node. Workers about
+    to idle will take work queued to other nodes, nodes running all of
+    their workers already never wake or spawn workers on other nodes.
+
+    Queues created on the threadpool of a single node will prefer to run
+    on that node instead.
+
+    Nodes are discovered using /sys/devices/system/node. A single node
+    holding all processors is assumed on platforms not providing it.
+ */
+class XDISPATCH_EXPORT numa_threadpool : public ithreadpool
+{
+public:
+    /**
+        @brief Constructor
+
+        @param config The configuration used for all nodes. Thread counts
+                      are distributed between the nodes and the affinity
+                      is used to pick processors from the nodes.
+     */
+    explicit numa_threadpool(const threadpool_config& config);
+
+    /**
+        @copydoc ithreadpool::execute
+     */
+    void execute(const operation_ptr& work, queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::execute_unique
+     */
+    void execute_unique(unique_operation&& work,
+                        queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::execute_bulk
+     */
+    void execute_bulk(std::vector<unique_operation>&& work,
+                      queue_priority priority) final;
+
+    /**
+        @copydoc ithreadpool::thread_bound
+     */
+    bool thread_bound() const final { return false; }
+
+    /**
+        @return the number of nodes
+     */
+    size_t node_count() const;
+
+    /**
+        @return the threadpool running on the node with the given index
+     */
+    std::shared_ptr<threadpool> node(size_t index) const;
+
+    /**
+        @return the index of the node the calling thread is running on
+     */
+    size_t current_node() const;
+
+protected:
+    /**
+        @brief Ignored as workers are running in the scope of the
+               threadpool of their node which is notified instead
+     */
+    void notify_thread_blocked() final;
+
+    /**
+        @copydoc notify_thread_blocked
+     */
+    void notify_thread_unblocked() final;
+
+private:
+    std::vector<std::shared_ptr<threadpool>> m_nodes;
+    // maps the index of a processor to the node it belongs to
+    std::vector<size_t> m_processor_nodes;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+/** @} */
+
+#endif /* XDISPATCH_NAIVE_THREADPOOL_PUBLIC_H_ */
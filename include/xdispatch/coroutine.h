@@ -0,0 +1,517 @@
+/*
+ * coroutine.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_COROUTINE_H_
+#define XDISPATCH_COROUTINE_H_
+
+/**
+ * @addtogroup xdispatch
+ * @{
+ */
+
+#ifndef __XDISPATCH_INDIRECT__
+    #error                                                                     \
+      "Please #include <xdispatch/dispatch.h> instead of this file directly."
+    #include "dispatch.h"
+#endif
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+
+    #include <atomic>
+    #include <coroutine>
+    #include <exception>
+    #include <memory>
+    #include <optional>
+    #include <stdexcept>
+    #include <utility>
+
+__XDISPATCH_BEGIN_NAMESPACE
+
+/**
+    @brief An operation resuming a suspended coroutine
+
+    Awaitables derive from this to hand themselves to interfaces
+    expecting an operation_ptr. The awaitable lives within the frame
+    of the coroutine until the coroutine got resumed so no ownership
+    is passed along and no memory needs to be allocated.
+ */
+class coroutine_operation : public operation
+{
+protected:
+    /**
+        @return an operation resuming the given coroutine when executed
+     */
+    operation_ptr resume_with(std::coroutine_handle<> handle)
+    {
+        m_handle = handle;
+        return operation_ptr(operation_ptr(), this);
+    }
+
+    void operator()() final { m_handle.resume(); }
+
+private:
+    std::coroutine_handle<> m_handle;
+};
+
+/**
+    @brief Resumes the awaiting coroutine on a queue
+
+    @see schedule(const queue&)
+ */
+class schedule_awaitable
+{
+public:
+    explicit schedule_awaitable(const queue& q)
+      : m_queue(q)
+    {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) const
+    {
+        // the coroutine may resume and release this awaitable
+        // before the call to async() returned
+        const auto q = m_queue;
+        q.async(unique_operation([handle] { handle.resume(); }));
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    queue m_queue;
+};
+
+/**
+    @brief Resumes the awaiting coroutine on a queue once a delay expired
+
+    @see after(const queue&, std::chrono::milliseconds)
+ */
+class after_awaitable : public coroutine_operation
+{
+public:
+    after_awaitable(const queue& q, std::chrono::milliseconds delay)
+      : coroutine_operation()
+      , m_queue(q)
+      , m_delay(delay)
+    {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        const auto q = m_queue;
+        q.after(m_delay, resume_with(handle));
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    queue m_queue;
+    std::chrono::milliseconds m_delay;
+};
+
+/**
+    @brief Resumes the awaiting coroutine on a queue once all
+           operations of a group completed
+
+    @see when_done(const group&, const queue&)
+ */
+class group_awaitable : public coroutine_operation
+{
+public:
+    group_awaitable(const group& g, const queue& q)
+      : coroutine_operation()
+      , m_group(g)
+      , m_queue(q)
+    {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        const auto g = m_group;
+        g.notify(resume_with(handle), m_queue);
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    group m_group;
+    queue m_queue;
+};
+
+/**
+    @brief Resumes the awaiting coroutine on the target queue of a
+           socket_notifier once its socket became ready
+
+    @see ready(const socket_notifier&)
+ */
+class socket_notifier_awaitable
+{
+public:
+    explicit socket_notifier_awaitable(const socket_notifier& notifier)
+      : m_notifier(notifier)
+    {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        auto notifier = m_notifier;
+        notifier.handler(std::make_shared<resumer>(handle));
+        notifier.resume();
+    }
+
+    void await_resume() { m_notifier.suspend(); }
+
+private:
+    /**
+        @brief The handler resuming the coroutine
+
+        It stays installed with the notifier once the coroutine resumed
+        and may be invoked again when the socket became ready meanwhile.
+        So it does not point into the frame of the coroutine, which might
+        be gone by then, and resumes the coroutine only once.
+     */
+    class resumer : public socket_notifier_operation
+    {
+    public:
+        explicit resumer(std::coroutine_handle<> handle)
+          : socket_notifier_operation()
+          , m_handle(handle.address())
+        {}
+
+    protected:
+        void operator()(socket_t, notifier_type) final
+        {
+            if (auto* const address = m_handle.exchange(nullptr)) {
+                std::coroutine_handle<>::from_address(address).resume();
+            }
+        }
+
+    private:
+        std::atomic<void*> m_handle;
+    };
+
+    socket_notifier m_notifier;
+};
+
+template<typename T = void>
+class task;
+
+/**
+    @brief State shared by the promises of all tasks
+ */
+class task_promise_base
+{
+public:
+    /**
+        @brief Resumes whoever awaited the task or releases
+               a detached task once it completed
+     */
+    struct final_awaitable
+    {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(
+          std::coroutine_handle<Promise> handle) noexcept
+        {
+            task_promise_base& promise = handle.promise();
+            if (promise.m_detached) {
+                const auto exception = std::move(promise.m_exception);
+                handle.destroy();
+                // nobody is going to look, report and drop it
+                report_unhandled_exception(exception);
+                return std::noop_coroutine();
+            }
+            return promise.m_continuation;
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    final_awaitable final_suspend() const noexcept { return {}; }
+
+    void unhandled_exception() noexcept
+    {
+        m_exception = std::current_exception();
+    }
+
+    void continuation(std::coroutine_handle<> handle)
+    {
+        m_continuation = handle;
+    }
+
+    void detach() { m_detached = true; }
+
+protected:
+    void rethrow_if_failed() const
+    {
+        if (m_exception) {
+            std::rethrow_exception(m_exception);
+        }
+    }
+
+private:
+    std::coroutine_handle<> m_continuation = std::noop_coroutine();
+    std::exception_ptr m_exception;
+    bool m_detached = false;
+};
+
+/**
+    @brief The promise of a task producing a value
+ */
+template<typename T>
+class task_promise : public task_promise_base
+{
+public:
+    task<T> get_return_object() noexcept;
+
+    template<typename U>
+    void return_value(U&& value)
+    {
+        m_value.emplace(std::forward<U>(value));
+    }
+
+    T result()
+    {
+        rethrow_if_failed();
+        return std::move(*m_value);
+    }
+
+private:
+    std::optional<T> m_value;
+};
+
+/**
+    @brief The promise of a task producing no value
+ */
+template<>
+class task_promise<void> : public task_promise_base
+{
+public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() const { rethrow_if_failed(); }
+};
+
+/**
+    @brief A lazily started coroutine producing a value of type T
+
+    The coroutine will not execute before it is either awaited or
+    started explicitly on a queue using start(). When awaited it
+    executes on the awaiting thread until suspending, the awaiting
+    coroutine continues on whatever thread the task completed on.
+    Exceptions thrown by the task are rethrown to the awaiting coroutine.
+
+    Use schedule() within the task to hop to a different queue.
+ */
+template<typename T>
+class task
+{
+public:
+    using promise_type = task_promise<T>;
+
+    task() noexcept
+      : m_handle()
+    {}
+
+    task(task&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    task(const task&) = delete;
+
+    ~task()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    task& operator=(const task&) = delete;
+
+    /**
+        @return true if the task holds a coroutine
+     */
+    explicit operator bool() const noexcept { return bool(m_handle); }
+
+    /**
+        @brief Starts the task on the given queue and returns immediately
+
+        The task is detached, i.e. the coroutine will be released as
+        soon as it completed and its result is discarded. An exception
+        escaping the task is reported and dropped once the coroutine
+        was released as there is nobody left to handle it.
+
+        @throws std::logic_error if the task holds no coroutine
+     */
+    void start(const queue& q = global_queue()) &&
+    {
+        if (!m_handle) {
+            throw std::logic_error("Cannot start an empty task");
+        }
+        m_handle.promise().detach();
+        const auto handle = std::exchange(m_handle, nullptr);
+        q.async(unique_operation([handle] { handle.resume(); }));
+    }
+
+    /**
+        @brief Starts the task and resumes the awaiting coroutine
+               with its result once it completed
+
+        @throws std::logic_error if the task holds no coroutine
+     */
+    auto operator co_await() &&
+    {
+        struct awaitable
+        {
+            bool await_ready() const noexcept { return m_handle.done(); }
+
+            std::coroutine_handle<> await_suspend(
+              std::coroutine_handle<> awaiting) noexcept
+            {
+                m_handle.promise().continuation(awaiting);
+                return m_handle;
+            }
+
+            T await_resume() { return m_handle.promise().result(); }
+
+            // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+            std::coroutine_handle<promise_type> m_handle;
+        };
+        if (!m_handle) {
+            throw std::logic_error("Cannot await an empty task");
+        }
+        return awaitable{ m_handle };
+    }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept
+      : m_handle(handle)
+    {}
+
+    std::coroutine_handle<promise_type> m_handle;
+
+    friend class task_promise<T>;
+};
+
+template<typename T>
+inline task<T>
+task_promise<T>::get_return_object() noexcept
+{
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void>
+task_promise<void>::get_return_object() noexcept
+{
+    return task<void>(
+      std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+/**
+    @brief Moves the awaiting coroutine onto the given queue
+
+    Use as co_await schedule(q) to continue execution of the
+    coroutine on the queue. The coroutine is resumed without
+    allocating any memory.
+
+    @param q The queue to resume the coroutine on
+ */
+inline schedule_awaitable
+schedule(const queue& q)
+{
+    return schedule_awaitable(q);
+}
+
+/**
+    @brief Suspends the awaiting coroutine for the given delay
+
+    Use as co_await after(q, delay) to continue execution of the
+    coroutine on the queue as soon as the delay expired.
+
+    @param q The queue to resume the coroutine on
+    @param delay The time to wait for
+ */
+inline after_awaitable
+after(const queue& q, std::chrono::milliseconds delay)
+{
+    return after_awaitable(q, delay);
+}
+
+/**
+    @brief Suspends the awaiting coroutine until all operations
+           of the group completed
+
+    Use as co_await when_done(g, q) to continue execution of the
+    coroutine on the given queue the same way a notification
+    would be submitted. No thread is blocked while waiting.
+
+    @param g The group to wait for
+    @param q The queue to resume the coroutine on
+ */
+inline group_awaitable
+when_done(const group& g, const queue& q = global_queue())
+{
+    return group_awaitable(g, q);
+}
+
+/**
+    @brief Suspends the awaiting coroutine until the socket is ready
+
+    Use as co_await ready(notifier) to continue execution of the
+    coroutine on the target queue once the socket becomes ready.
+    This replaces the handler of the notifier which needs to be
+    suspended, it will be resumed while awaiting and suspended
+    again before the coroutine continues.
+
+    @param notifier The notifier watching the socket
+ */
+inline socket_notifier_awaitable
+ready(const socket_notifier& notifier)
+{
+    return socket_notifier_awaitable(notifier);
+}
+
+__XDISPATCH_END_NAMESPACE
+
+#endif // XDISPATCH2_HAVE_COROUTINES
+
+/** @} */
+
+#endif /* XDISPATCH_COROUTINE_H_ */
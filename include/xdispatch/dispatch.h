@@ -38,6 +38,7 @@
     #include "xdispatch/group.h"
     #include "xdispatch/socket_notifier.h"
     #include "xdispatch/timer.h"
+    #include "xdispatch/coroutine.h"
     #undef __XDISPATCH_INDIRECT__
 
 #endif /* defined(__cplusplus) */
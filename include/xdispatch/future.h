@@ -0,0 +1,739 @@
+/*
+ * future.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_FUTURE_H_
+#define XDISPATCH_FUTURE_H_
+
+/**
+ * @addtogroup xdispatch
+ * @{
+ */
+
+#include "xdispatch/dispatch.h"
+#include "xdispatch/impl/iqueue_impl.h"
+#include "xdispatch/impl/lightweight_barrier.h"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+__XDISPATCH_BEGIN_NAMESPACE
+
+template<typename T>
+class future;
+
+template<typename T>
+class promise;
+
+/**
+    @brief Private Internal Class
+
+    Tracks completion of a future and holds the single continuation
+    to be scheduled once a value or exception has been set.
+ */
+class future_state_base
+{
+public:
+    future_state_base() = default;
+    future_state_base(const future_state_base&) = delete;
+    future_state_base& operator=(const future_state_base&) = delete;
+
+    /**
+        @return true once a value or an exception has been set
+     */
+    bool is_ready() const
+    {
+        return READY == m_status.load(std::memory_order_acquire);
+    }
+
+    /**
+        @brief Sets the operation to run once the state became ready
+
+        The operation is queued on the given queue or executed on the
+        completing thread when no queue is given. Only a single
+        continuation is supported.
+     */
+    void continue_with(iqueue_impl_ptr queue, unique_operation&& op)
+    {
+        m_queue = std::move(queue);
+        m_continuation = std::move(op);
+        int expected = PENDING;
+        if (!m_status.compare_exchange_strong(expected,
+                                              CONTINUED,
+                                              std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+            // completed meanwhile
+            dispatch();
+        }
+    }
+
+    /**
+        @brief Fails the state with the given exception
+     */
+    void fail(std::exception_ptr exception)
+    {
+        m_exception = std::move(exception);
+        complete();
+    }
+
+protected:
+    void complete()
+    {
+        if (CONTINUED == m_status.exchange(READY, std::memory_order_acq_rel)) {
+            dispatch();
+        }
+    }
+
+    void rethrow_if_failed() const
+    {
+        if (m_exception) {
+            std::rethrow_exception(m_exception);
+        }
+    }
+
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::exception_ptr m_exception;
+
+private:
+    enum status : int
+    {
+        PENDING,
+        CONTINUED,
+        READY
+    };
+
+    void dispatch()
+    {
+        // the continuation usually keeps this state alive,
+        // move it out to break the cycle once it executed
+        auto op = std::move(m_continuation);
+        const auto queue = std::move(m_queue);
+        if (queue) {
+            queue->async_unique(std::move(op));
+        } else {
+            execute_operation_on_this_thread(op);
+        }
+    }
+
+    std::atomic<int> m_status{ PENDING };
+    iqueue_impl_ptr m_queue;
+    unique_operation m_continuation;
+    bool m_retrieved = false;
+
+    template<typename T>
+    friend class promise;
+};
+
+/**
+    @brief Private Internal Class
+
+    The state shared by a promise and its future holding a value of type T
+ */
+template<typename T>
+class future_state : public future_state_base
+{
+public:
+    future_state() = default;
+
+    ~future_state()
+    {
+        if (is_ready() && !m_exception) {
+            reinterpret_cast<T*>(&m_storage)->~T();
+        }
+    }
+
+    template<typename... Args>
+    void emplace(Args&&... args)
+    {
+        new (&m_storage) T(std::forward<Args>(args)...);
+        complete();
+    }
+
+    T take()
+    {
+        rethrow_if_failed();
+        return std::move(*reinterpret_cast<T*>(&m_storage));
+    }
+
+private:
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+};
+
+/**
+    @brief Private Internal Class
+
+    The state shared by a promise and its future not holding any value
+ */
+template<>
+class future_state<void> : public future_state_base
+{
+public:
+    void emplace() { complete(); }
+
+    void take() const { rethrow_if_failed(); }
+};
+
+template<typename T>
+using future_state_ptr = std::shared_ptr<future_state<T>>;
+
+/**
+    @brief Sets the result of a future which may be picked up
+           by operations on any queue
+
+    A promise which is destroyed without a value or exception having
+    been set will fail its future with std::logic_error.
+ */
+template<typename T>
+class promise
+{
+public:
+    /**
+        @brief Creates a new promise together with the shared state
+     */
+    promise()
+      : m_state(std::make_shared<future_state<T>>())
+    {}
+
+    promise(promise&& other) noexcept = default;
+
+    promise(const promise&) = delete;
+
+    ~promise() { abandon(); }
+
+    promise& operator=(promise&& other) noexcept
+    {
+        if (this != &other) {
+            abandon();
+            m_state = std::move(other.m_state);
+        }
+        return *this;
+    }
+
+    promise& operator=(const promise&) = delete;
+
+    /**
+        @return the future to be completed by this promise
+
+        @throws std::logic_error if the future was retrieved already
+     */
+    future<T> get_future()
+    {
+        if (!m_state || m_state->m_retrieved) {
+            throw std::logic_error("The future was retrieved already");
+        }
+        m_state->m_retrieved = true;
+        return future<T>(m_state);
+    }
+
+    /**
+        @brief Completes the future with a value constructed from args
+
+        Use without any arguments for a promise<void>. Must only be
+        called once and not together with set_exception().
+     */
+    template<typename... Args>
+    void set_value(Args&&... args)
+    {
+        m_state->emplace(std::forward<Args>(args)...);
+    }
+
+    /**
+        @brief Completes the future with the given exception
+
+        The exception is rethrown when the value is retrieved from
+        the future and passed on to all futures chained to it.
+     */
+    void set_exception(std::exception_ptr exception)
+    {
+        m_state->fail(std::move(exception));
+    }
+
+private:
+    void abandon()
+    {
+        if (m_state && !m_state->is_ready()) {
+            set_exception(std::make_exception_ptr(
+              std::logic_error("The promise was destroyed without a value")));
+        }
+    }
+
+    future_state_ptr<T> m_state;
+};
+
+/**
+    @brief Private Internal Class
+
+    Determines the value type of the future returned by future::then()
+ */
+template<typename R>
+struct future_unwrap
+{
+    using type = R;
+};
+
+template<typename U>
+struct future_unwrap<future<U>>
+{
+    using type = U;
+};
+
+template<typename Func, typename T>
+struct future_continuation
+{
+    using result = decltype(std::declval<Func&>()(std::declval<T>()));
+    using type = typename future_unwrap<result>::type;
+};
+
+template<typename Func>
+struct future_continuation<Func, void>
+{
+    using result = decltype(std::declval<Func&>()());
+    using type = typename future_unwrap<result>::type;
+};
+
+/**
+    @brief Private Internal Class
+
+    Passes the result of a function on to a promise
+ */
+template<typename R>
+struct future_fulfill
+{
+    template<typename Func, typename... Args>
+    static void with(promise<R>& p, Func& f, Args&&... args)
+    {
+        p.set_value(f(std::forward<Args>(args)...));
+    }
+};
+
+template<>
+struct future_fulfill<void>
+{
+    template<typename Func, typename... Args>
+    static void with(promise<void>& p, Func& f, Args&&... args)
+    {
+        f(std::forward<Args>(args)...);
+        p.set_value();
+    }
+};
+
+template<typename U>
+struct future_fulfill<future<U>>
+{
+    template<typename Func, typename... Args>
+    static void with(promise<U>& p, Func& f, Args&&... args)
+    {
+        auto inner = f(std::forward<Args>(args)...);
+        if (!inner.valid()) {
+            p.set_exception(std::make_exception_ptr(
+              std::logic_error("The continuation returned an invalid future")));
+            return;
+        }
+        inner.forward_to(std::move(p));
+    }
+};
+
+/**
+    @brief Private Internal Class
+
+    Invokes a function with the value held by a state
+ */
+template<typename T>
+struct future_invoke
+{
+    template<typename R, typename Func>
+    static void with(future_state<T>& state,
+                     promise<typename future_unwrap<R>::type>& p,
+                     Func& f)
+    {
+        future_fulfill<R>::with(p, f, state.take());
+    }
+};
+
+template<>
+struct future_invoke<void>
+{
+    template<typename R, typename Func>
+    static void with(future_state<void>& state,
+                     promise<typename future_unwrap<R>::type>& p,
+                     Func& f)
+    {
+        state.take();
+        future_fulfill<R>::with(p, f);
+    }
+};
+
+/**
+    @brief Private Internal Function
+
+    Passes the value held by state on to p
+ */
+template<typename T>
+inline void
+future_forward(future_state<T>& state, promise<T>& p)
+{
+    p.set_value(state.take());
+}
+
+inline void
+future_forward(future_state<void>& state, promise<void>& p)
+{
+    state.take();
+    p.set_value();
+}
+
+/**
+    @brief Private Internal Class
+
+    Collects the values of all states once they completed
+ */
+template<typename T>
+struct future_all
+{
+    using value = std::vector<T>;
+
+    static void collect(const std::vector<future_state_ptr<T>>& states,
+                        promise<value>& p)
+    {
+        value values;
+        values.reserve(states.size());
+        for (const auto& state : states) {
+            values.push_back(state->take());
+        }
+        p.set_value(std::move(values));
+    }
+};
+
+template<>
+struct future_all<void>
+{
+    using value = void;
+
+    static void collect(const std::vector<future_state_ptr<void>>& states,
+                        promise<value>& p)
+    {
+        for (const auto& state : states) {
+            state->take();
+        }
+        p.set_value();
+    }
+};
+
+/**
+    @brief Private Internal Class
+
+    Passes on the value of the state which completed first
+ */
+template<typename T>
+struct future_any
+{
+    using value = std::pair<size_t, T>;
+
+    static void complete(size_t index,
+                         future_state<T>& state,
+                         promise<value>& p)
+    {
+        p.set_value(index, state.take());
+    }
+};
+
+template<>
+struct future_any<void>
+{
+    using value = size_t;
+
+    static void complete(size_t index,
+                         future_state<void>& state,
+                         promise<value>& p)
+    {
+        state.take();
+        p.set_value(index);
+    }
+};
+
+/**
+    @brief A value of type T becoming available at a later time
+
+    Instead of blocking until the value is available, continuations
+    are chained using then() and will be queued as soon as the value
+    was set. The continuation is kept within the state shared with the
+    promise so that no additional memory is needed for small functions.
+
+    A future is move-only and can be consumed once, i.e. by either
+    calling then(), get() or passing it to when_all() or when_any().
+ */
+template<typename T>
+class future
+{
+public:
+    /**
+        @brief Creates an invalid future
+     */
+    future() noexcept = default;
+
+    future(future&&) noexcept = default;
+    future(const future&) = delete;
+    ~future() = default;
+
+    future& operator=(future&&) noexcept = default;
+    future& operator=(const future&) = delete;
+
+    /**
+        @return true if the future refers to a shared state
+     */
+    bool valid() const noexcept { return bool(m_state); }
+
+    /**
+        @return true if the value or an exception has been set
+     */
+    bool is_ready() const { return m_state && m_state->is_ready(); }
+
+    /**
+        @brief Queues f on q as soon as the value of this future is set
+
+        f is invoked with the value of this future, a future<void> will
+        invoke f without any arguments. The returned future will hold
+        the result of f. If f returns a future itself, the returned
+        future will complete once that inner future completed.
+
+        When this future failed f is not invoked and the exception
+        is passed on to the returned future. The same is true for
+        exceptions thrown by f.
+
+        @throws std::logic_error if the future is not valid()
+
+        The future is invalid afterwards.
+     */
+    template<typename Func>
+    future<typename future_continuation<Func, T>::type> then(const queue& q,
+                                                             Func&& f)
+    {
+        using result = typename future_continuation<Func, T>::result;
+        using value = typename future_continuation<Func, T>::type;
+        using function = typename std::decay<Func>::type;
+
+        if (!m_state) {
+            throw std::logic_error("The future is not valid");
+        }
+        promise<value> next;
+        auto next_future = next.get_future();
+        auto state = std::move(m_state);
+        state->continue_with(
+          q.implementation(),
+          unique_operation([state,
+                            next = std::move(next),
+                            f = function(std::forward<Func>(f))]() mutable {
+              try {
+                  future_invoke<T>::template with<result>(*state, next, f);
+              } catch (...) {
+                  next.set_exception(std::current_exception());
+              }
+          }));
+        return next_future;
+    }
+
+    /**
+        @brief Blocks the caller until the value was set and returns it
+
+        This will block the calling thread, never call this from an
+        operation executing on a queue but use then() instead.
+
+        @throws the exception set in case the future failed
+        @throws std::logic_error if the future is not valid()
+
+        The future is invalid afterwards.
+     */
+    T get()
+    {
+        if (!m_state) {
+            throw std::logic_error("The future is not valid");
+        }
+        const auto state = std::move(m_state);
+        if (!state->is_ready()) {
+            lightweight_barrier barrier;
+            state->continue_with(
+              iqueue_impl_ptr(),
+              unique_operation([&barrier] { barrier.complete(); }));
+            barrier.wait();
+        }
+        return state->take();
+    }
+
+private:
+    explicit future(future_state_ptr<T> state)
+      : m_state(std::move(state))
+    {}
+
+    // completes p with the result of this future on the completing thread
+    void forward_to(promise<T>&& p)
+    {
+        auto state = std::move(m_state);
+        state->continue_with(
+          iqueue_impl_ptr(),
+          unique_operation([state, p = std::move(p)]() mutable {
+              try {
+                  future_forward(*state, p);
+              } catch (...) {
+                  p.set_exception(std::current_exception());
+              }
+          }));
+    }
+
+    future_state_ptr<T> m_state;
+
+    friend class promise<T>;
+    template<typename R>
+    friend struct future_fulfill;
+    template<typename U>
+    friend future<typename future_all<U>::value> when_all(
+      std::vector<future<U>> futures);
+    template<typename U>
+    friend future<typename future_any<U>::value> when_any(
+      std::vector<future<U>> futures);
+};
+
+/**
+    @brief Queues f on q and returns a future holding its result
+
+    @see future::then()
+ */
+template<typename Func>
+inline future<typename future_continuation<Func, void>::type>
+async(const queue& q, Func&& f)
+{
+    using result = typename future_continuation<Func, void>::result;
+    using value = typename future_continuation<Func, void>::type;
+    using function = typename std::decay<Func>::type;
+
+    promise<value> p;
+    auto result_future = p.get_future();
+    q.implementation()->async_unique(unique_operation(
+      [p = std::move(p), f = function(std::forward<Func>(f))]() mutable {
+          try {
+              future_fulfill<result>::with(p, f);
+          } catch (...) {
+              p.set_exception(std::current_exception());
+          }
+      }));
+    return result_future;
+}
+
+/**
+    @brief Returns a future completing once all of the given futures
+           completed
+
+    The returned future holds the values of all futures in the order
+    they were passed or fails with the exception of the first future
+    failing in that order. A future<void> is returned for futures not
+    holding any value.
+ */
+template<typename T>
+inline future<typename future_all<T>::value>
+when_all(std::vector<future<T>> futures)
+{
+    struct all_state
+    {
+        promise<typename future_all<T>::value> result;
+        std::vector<future_state_ptr<T>> states;
+        std::atomic<size_t> remaining;
+    };
+
+    auto all = std::make_shared<all_state>();
+    auto all_future = all->result.get_future();
+    all->remaining = futures.size() + 1;
+    for (auto& f : futures) {
+        all->states.push_back(std::move(f.m_state));
+    }
+
+    const auto completed = [all] {
+        if (1 == all->remaining.fetch_sub(1, std::memory_order_acq_rel)) {
+            try {
+                future_all<T>::collect(all->states, all->result);
+            } catch (...) {
+                all->result.set_exception(std::current_exception());
+            }
+        }
+    };
+    for (const auto& state : all->states) {
+        state->continue_with(iqueue_impl_ptr(),
+                             unique_operation([state, completed] {
+                                 completed();
+                             }));
+    }
+    completed();
+    return all_future;
+}
+
+/**
+    @brief Returns a future completing as soon as the first of the given
+           futures completed
+
+    The returned future holds the index of the future which completed
+    first together with its value or fails with its exception. Only the
+    index is provided for futures not holding any value.
+
+    The returned future will fail when no futures are given.
+ */
+template<typename T>
+inline future<typename future_any<T>::value>
+when_any(std::vector<future<T>> futures)
+{
+    struct any_state
+    {
+        promise<typename future_any<T>::value> result;
+        std::atomic<bool> done{ false };
+    };
+
+    auto any = std::make_shared<any_state>();
+    auto any_future = any->result.get_future();
+    if (futures.empty()) {
+        any->done = true;
+        any->result.set_exception(std::make_exception_ptr(
+          std::logic_error("when_any() requires at least one future")));
+        return any_future;
+    }
+
+    for (size_t index = 0; index < futures.size(); ++index) {
+        auto state = std::move(futures[index].m_state);
+        state->continue_with(
+          iqueue_impl_ptr(), unique_operation([state, any, index] {
+              if (any->done.exchange(true, std::memory_order_acq_rel)) {
+                  return;
+              }
+              try {
+                  future_any<T>::complete(index, *state, any->result);
+              } catch (...) {
+                  any->result.set_exception(std::current_exception());
+              }
+          }));
+    }
+    return any_future;
+}
+
+__XDISPATCH_END_NAMESPACE
+
+/** @} */
+
+#endif /* XDISPATCH_FUTURE_H_ */
@@ -134,6 +134,10 @@ public:
         The operation will be empty at the time the notification block is
        submitted to the target queue immediately. The group may either be
        deleted or reused for additional operations.
+
+        Operations added to the group after the notification was scheduled
+       delay it as well for as long as the group did not become empty
+       meanwhile, e.g. operations added from within one of its operations.
     */
     void notify(const operation_ptr& op, const queue& q = global_queue()) const;
 
@@ -159,6 +163,11 @@ public:
         Waits until the given time has passed
         or all dispatched operations in the group were executed
 
+        This waits until the group becomes empty, operations added to the
+        group while waiting are waited for as well, e.g. operations added
+        from within one of its operations. Operations added only once the
+        group became empty are not.
+
         @param t give a time here, will wait forever by default
         @return false if the timeout occured or true if all operations were
        executed
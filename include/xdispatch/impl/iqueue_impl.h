@@ -29,6 +29,8 @@
 
 #include "xdispatch/impl/ibackend.h"
 
+#include <vector>
+
 __XDISPATCH_BEGIN_NAMESPACE
 
 /**
@@ -54,6 +56,31 @@ public:
       */
     virtual void async(const operation_ptr& op) = 0;
 
+    /**
+      Same as async(const operation_ptr&) but taking over the
+      given operation.
+
+      Implementations able to queue the operation without shared
+      ownership should override this, the default implementation
+      will move the operation into an operation_ptr.
+      */
+    virtual void async_unique(unique_operation&& op) { async(op.share()); }
+
+    /**
+      Same as async_unique(unique_operation&&) but taking over all
+      of the given operations at once.
+
+      Implementations able to queue many operations at once should
+      override this to reduce the cost per operation, the default
+      implementation will queue the operations one by one.
+      */
+    virtual void async_bulk(std::vector<unique_operation>&& ops)
+    {
+        for (auto& op : ops) {
+            async_unique(std::move(op));
+        }
+    }
+
     /**
         Applies the given iteration_operation for execution
         in this iqueue_impl and blocks until times executions
@@ -63,6 +90,23 @@ public:
     */
     virtual void apply(size_t times, const iteration_operation_ptr& op) = 0;
 
+    /**
+      Same as apply() but executing the iterations in chunks of
+      grain iterations each.
+
+      Implementations able to split the iterations should override this,
+      the default implementation ignores the grain.
+
+      @param grain The number of iterations per chunk or 0 to choose
+                   a suitable number automatically
+      */
+    virtual void apply_chunked(size_t times,
+                               const iteration_operation_ptr& op,
+                               size_t /* grain */)
+    {
+        apply(times, op);
+    }
+
     /**
         Applies the given operation for async execution
         in this iqueue_impl after the given time and returns immediately.
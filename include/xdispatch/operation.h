@@ -28,10 +28,17 @@
  */
 
 #include "dispatch_decl.h"
+#include "operation_allocator.h"
 
 #include <string>
 #include <memory>
 #include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 __XDISPATCH_BEGIN_NAMESPACE
 
@@ -45,6 +52,13 @@ class parameterized_operation;
 XDISPATCH_EXPORT void
 execute_operation_on_this_thread(operation&);
 
+/**
+  Reports an exception escaping work nobody is left to handle it for,
+  e.g. a detached coroutine, and drops it
+  */
+XDISPATCH_EXPORT void
+report_unhandled_exception(const std::exception_ptr& exception) noexcept;
+
 /**
   Will synchronously execute the given operation on the current thread
   for the given parameters
@@ -141,7 +155,7 @@ public:
       parameterized_operation_ptr<Params...>>::type
     make(const Func& f)
     {
-        return std::make_shared<
+        return make_pooled_operation<
           function_parameterized_operation<Func, Params...>>(f);
     }
 
@@ -150,8 +164,8 @@ public:
       T* object,
       void (T::*function)(Params...))
     {
-        return std::make_shared<member_parameterized_operation<T, Params...>>(
-          object, function);
+        return make_pooled_operation<
+          member_parameterized_operation<T, Params...>>(object, function);
     }
 
 protected:
@@ -238,14 +252,284 @@ inline typename std::enable_if<!std::is_convertible<Func, operation_ptr>::value,
                                operation_ptr>::type
 make_operation(const Func& f)
 {
-    return std::make_shared<function_operation<Func>>(f);
+    return make_pooled_operation<function_operation<Func>>(f);
 }
 
 template<class T>
 inline operation_ptr
 make_operation(T* object, void (T::*function)())
 {
-    return std::make_shared<member_operation<T>>(object, function);
+    return make_pooled_operation<member_operation<T>>(object, function);
+}
+
+/**
+  A move-only operation owning the function it executes
+
+  Function objects of up to inline_size bytes and not requiring more than
+  pointer alignment are stored within the operation itself so that creating
+  one does not allocate any memory, all others are moved to the heap.
+  Unlike operation_ptr no shared ownership is involved which makes it the
+  cheapest way to pass work that is executed exactly once.
+
+  An operation_ptr can be wrapped for compatibility.
+  */
+class unique_operation : public pooled_allocation
+{
+    // exclude all types handled by the other constructors
+    template<typename Func>
+    using enable_if_function = typename std::enable_if<
+      !std::is_same<typename std::decay<Func>::type, unique_operation>::value &&
+      !std::is_convertible<Func, operation_ptr>::value>::type;
+
+public:
+    /// the maximum size of function objects stored inline
+    static constexpr size_t inline_size = 48;
+
+    /**
+      Creates an empty operation
+      */
+    unique_operation() noexcept
+      : m_vtable(nullptr)
+    {}
+
+    /**
+      Creates an operation executing the given function object
+      */
+    template<typename Func, typename = enable_if_function<Func>>
+    explicit unique_operation(Func&& f)
+      : m_vtable(nullptr)
+    {
+        emplace<typename std::decay<Func>::type>(std::forward<Func>(f));
+    }
+
+    /**
+      Creates an operation executing the given shared operation
+      */
+    explicit unique_operation(operation_ptr op)
+      : m_vtable(nullptr)
+    {
+        if (op) {
+            emplace<shared_function>(std::move(op));
+        }
+    }
+
+    unique_operation(unique_operation&& other) noexcept
+      : m_vtable(nullptr)
+    {
+        take(other);
+    }
+
+    unique_operation(const unique_operation&) = delete;
+
+    ~unique_operation() { reset(); }
+
+    unique_operation& operator=(unique_operation&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    unique_operation& operator=(const unique_operation&) = delete;
+
+    /**
+      @return true if the operation holds a function
+      */
+    explicit operator bool() const noexcept { return nullptr != m_vtable; }
+
+    /**
+      Releases the function held by the operation
+      */
+    void reset() noexcept
+    {
+        if (m_vtable) {
+            if (m_vtable->destroy) {
+                m_vtable->destroy(m_storage);
+            }
+            m_vtable = nullptr;
+        }
+    }
+
+    /**
+      Moves the function held by this operation into an operation_ptr
+
+      Use this to pass the operation to interfaces requiring shared
+      ownership. The operation will be empty afterwards.
+      */
+    operation_ptr share();
+
+private:
+    // relocate and destroy are left empty for functions
+    // which can be moved by copying their bytes
+    struct vtable
+    {
+        void (*invoke)(void*);
+        void (*relocate)(void*, void*);
+        void (*destroy)(void*);
+        operation_ptr* (*shared)(void*);
+    };
+
+    struct shared_function
+    {
+        explicit shared_function(operation_ptr op)
+          : m_op(std::move(op))
+        {}
+
+        void operator()() { execute_operation_on_this_thread(*m_op); }
+
+        // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+        operation_ptr m_op;
+    };
+
+    static operation_ptr* shared_of(shared_function* f) { return &f->m_op; }
+
+    static operation_ptr* shared_of(void*) { return nullptr; }
+
+    template<typename F>
+    struct inline_model
+    {
+        static void invoke(void* s) { (*static_cast<F*>(s))(); }
+
+        static void relocate(void* from, void* to)
+        {
+            auto* f = static_cast<F*>(from);
+            new (to) F(std::move(*f));
+            f->~F();
+        }
+
+        static void destroy(void* s) { static_cast<F*>(s)->~F(); }
+
+        static operation_ptr* shared(void* s)
+        {
+            return shared_of(static_cast<F*>(s));
+        }
+    };
+
+    template<typename F>
+    struct heap_model
+    {
+        static void invoke(void* s) { (**static_cast<F**>(s))(); }
+
+        static void destroy(void* s)
+        {
+            auto* f = *static_cast<F**>(s);
+            f->~F();
+            deallocate_operation(f, sizeof(F), alignof(F));
+        }
+
+        static operation_ptr* shared(void*) { return nullptr; }
+    };
+
+    // only trivially copyable types may be moved by copying their bytes,
+    // all others including shared_function are moved by their constructor
+    template<typename F>
+    using is_relocatable = std::is_trivially_copyable<F>;
+
+    template<typename F>
+    using fits_inline = std::integral_constant<
+      bool,
+      sizeof(F) <= inline_size && alignof(F) <= alignof(void*) &&
+        std::is_nothrow_move_constructible<F>::value>;
+
+    template<typename F, typename... Args>
+    void emplace(Args&&... args)
+    {
+        construct<F>(fits_inline<F>(), std::forward<Args>(args)...);
+    }
+
+    template<typename F, typename... Args>
+    void construct(std::true_type /* inline */, Args&&... args)
+    {
+        static const vtable s_vtable = {
+            &inline_model<F>::invoke,
+            is_relocatable<F>::value ? nullptr : &inline_model<F>::relocate,
+            std::is_trivially_destructible<F>::value
+              ? nullptr
+              : &inline_model<F>::destroy,
+            &inline_model<F>::shared
+        };
+        new (m_storage) F(std::forward<Args>(args)...);
+        m_vtable = &s_vtable;
+    }
+
+    template<typename F, typename... Args>
+    void construct(std::false_type /* inline */, Args&&... args)
+    {
+        static const vtable s_vtable = { &heap_model<F>::invoke,
+                                         nullptr,
+                                         &heap_model<F>::destroy,
+                                         &heap_model<F>::shared };
+        void* memory = allocate_operation(sizeof(F), alignof(F));
+        try {
+            new (m_storage) F*(new (memory) F(std::forward<Args>(args)...));
+        } catch (...) {
+            deallocate_operation(memory, sizeof(F), alignof(F));
+            throw;
+        }
+        m_vtable = &s_vtable;
+    }
+
+    void take(unique_operation& other) noexcept
+    {
+        m_vtable = other.m_vtable;
+        if (m_vtable) {
+            if (m_vtable->relocate) {
+                m_vtable->relocate(other.m_storage, m_storage);
+            } else {
+                std::memcpy(m_storage, other.m_storage, inline_size);
+            }
+            other.m_vtable = nullptr;
+        }
+    }
+
+    const vtable* m_vtable;
+    alignas(void*) unsigned char m_storage[inline_size];
+
+    // allow access to internals
+    friend void execute_operation_on_this_thread(unique_operation&);
+};
+
+/**
+  Will synchronously execute the given operation on the current thread
+  */
+inline void
+execute_operation_on_this_thread(unique_operation& op)
+{
+    op.m_vtable->invoke(op.m_storage);
+}
+
+/**
+  Wraps a unique_operation as an xdispatch::operation
+  */
+class unique_function_operation : public operation
+{
+public:
+    explicit unique_function_operation(unique_operation&& op)
+      : operation()
+      , m_op(std::move(op))
+    {}
+
+    void operator()() final { execute_operation_on_this_thread(m_op); }
+
+private:
+    unique_operation m_op;
+};
+
+inline operation_ptr
+unique_operation::share()
+{
+    if (nullptr == m_vtable) {
+        return operation_ptr();
+    }
+    // do not wrap a shared operation once more
+    if (auto* shared = m_vtable->shared(m_storage)) {
+        auto op = std::move(*shared);
+        reset();
+        return op;
+    }
+    return make_pooled_operation<unique_function_operation>(std::move(*this));
 }
 
 /**
@@ -0,0 +1,233 @@
+/*
+ * operation_allocator.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_OPERATION_ALLOCATOR_H_
+#define XDISPATCH_OPERATION_ALLOCATOR_H_
+
+/**
+ * @addtogroup xdispatch
+ * @{
+ */
+
+#include "dispatch_decl.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+__XDISPATCH_BEGIN_NAMESPACE
+
+/**
+    @brief Statistics on the memory allocated for operations
+ */
+struct operation_allocator_statistics
+{
+    /// the number of allocations served by the global allocator
+    uint64_t allocations = 0;
+    /// the number of allocations served by reusing the memory of
+    /// operations released before
+    uint64_t recycled = 0;
+    /// the number of released operations handed back to the global
+    /// allocator as the free lists of a thread were full
+    uint64_t trimmed = 0;
+};
+
+/**
+    @brief Allocates memory for an operation
+
+    Small allocations are served from thread local free lists holding the
+    memory of operations released before. Operations often complete on a
+    different thread than the one they were created on, their memory is
+    handed back to the allocating thread in batches. Threads of the naive
+    backend hand back any pending batch before going idle, all others
+    do so at the latest when exiting.
+
+    The free lists grow to hold as many operations as have been in flight
+    at the same time and are kept for reuse afterwards. Each thread keeps
+    up to 1 MiB this way, memory released beyond that is returned to the
+    global allocator right away.
+
+    @param size The number of bytes to allocate
+    @return The allocated memory, never null
+ */
+XDISPATCH_EXPORT void*
+allocate_operation(size_t size);
+
+/**
+    @brief Releases memory obtained from allocate_operation()
+
+    May be called from any thread.
+
+    @param memory The memory to release
+    @param size The number of bytes passed to allocate_operation()
+ */
+XDISPATCH_EXPORT void
+deallocate_operation(void* memory, size_t size);
+
+/**
+    @brief Allocates memory for an operation requiring a specific alignment
+
+    Memory obtained from allocate_operation(size_t) is aligned by 16 bytes
+    only. Allocations requiring more than that are served by the global
+    allocator and never pooled.
+
+    @param size The number of bytes to allocate
+    @param alignment The alignment required, a power of two
+    @return The allocated memory, never null
+ */
+XDISPATCH_EXPORT void*
+allocate_operation(size_t size, size_t alignment);
+
+/**
+    @brief Releases memory obtained from allocate_operation(size_t, size_t)
+
+    May be called from any thread.
+
+    @param memory The memory to release
+    @param size The number of bytes passed to allocate_operation()
+    @param alignment The alignment passed to allocate_operation()
+ */
+XDISPATCH_EXPORT void
+deallocate_operation(void* memory, size_t size, size_t alignment);
+
+/**
+    @brief Enables or disables the use of the free lists
+
+    Pooling is enabled by default unless the environment variable
+    XDISPATCH2_OPERATION_POOLING is set to 0. It can be changed at any
+    time, memory allocated before will be released correctly.
+ */
+XDISPATCH_EXPORT void
+operation_pooling(bool enabled);
+
+/**
+    @return true if operations are allocated from the free lists
+ */
+XDISPATCH_EXPORT bool
+operation_pooling();
+
+/**
+    @return Statistics on the allocations made for operations so far
+ */
+XDISPATCH_EXPORT operation_allocator_statistics
+operation_allocations();
+
+/**
+    @brief An allocator using allocate_operation()
+
+    Use this with std::allocate_shared to create operations.
+ */
+template<typename T>
+class operation_allocator
+{
+public:
+    using value_type = T;
+
+    operation_allocator() = default;
+
+    template<typename U>
+    operation_allocator(const operation_allocator<U>&) noexcept
+    {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(allocate_operation(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        deallocate_operation(p, n * sizeof(T), alignof(T));
+    }
+};
+
+template<typename T, typename U>
+inline bool
+operator==(const operation_allocator<T>&, const operation_allocator<U>&)
+{
+    return true;
+}
+
+template<typename T, typename U>
+inline bool
+operator!=(const operation_allocator<T>&, const operation_allocator<U>&)
+{
+    return false;
+}
+
+/**
+    @brief Creates a shared operation using operation_allocator
+
+    The object and its reference count share a single allocation.
+ */
+template<typename T, typename... Args>
+inline std::shared_ptr<T>
+make_pooled_operation(Args&&... args)
+{
+    return std::allocate_shared<T>(operation_allocator<T>(),
+                                   std::forward<Args>(args)...);
+}
+
+/**
+    @brief Base class for types to be allocated using allocate_operation()
+           whenever they are created with new
+ */
+class pooled_allocation
+{
+public:
+    static void* operator new(size_t size) { return allocate_operation(size); }
+
+    static void operator delete(void* memory, size_t size) noexcept
+    {
+        deallocate_operation(memory, size);
+    }
+
+    // placement new would be hidden otherwise
+    static void* operator new(size_t, void* memory) noexcept { return memory; }
+
+    static void operator delete(void*, void*) noexcept {}
+
+#if (defined __cpp_aligned_new)
+    // over-aligned types would use the overloads above otherwise
+    static void* operator new(size_t size, std::align_val_t alignment)
+    {
+        return allocate_operation(size, static_cast<size_t>(alignment));
+    }
+
+    static void operator delete(void* memory,
+                                size_t size,
+                                std::align_val_t alignment) noexcept
+    {
+        deallocate_operation(memory, size, static_cast<size_t>(alignment));
+    }
+#endif
+
+protected:
+    pooled_allocation() = default;
+    ~pooled_allocation() = default;
+};
+
+__XDISPATCH_END_NAMESPACE
+
+/** @} */
+
+#endif /* XDISPATCH_OPERATION_ALLOCATOR_H_ */
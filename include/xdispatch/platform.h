@@ -56,4 +56,11 @@
         Ret __attribute__((warn_unused_result))
 #endif
 
+// coroutines depend on the language standard chosen when compiling
+#if (defined __cpp_impl_coroutine) && (defined __has_include)
+    #if __has_include(<coroutine>)
+        #define XDISPATCH2_HAVE_COROUTINES 1
+    #endif
+#endif
+
 #endif // XDISPATCH_PLATFORM_H_
@@ -33,6 +33,9 @@
     #include "dispatch.h"
 #endif
 
+#include <iterator>
+#include <vector>
+
 __XDISPATCH_BEGIN_NAMESPACE
 
 class iqueue_impl;
@@ -90,34 +93,87 @@ public:
     /**
         @see async(operation_ptr).
 
-        Will put the given function on the queue.
+        Will take over the given operation without any shared ownership
+        involved.
+    */
+    void async(unique_operation&& op) const;
+
+    /**
+        @see async(operation_ptr).
+
+        Will put the given function on the queue. The function is moved
+        into a unique_operation so that small functions do not cause any
+        heap allocation.
         The group and queue will be retained by the system until the operation
        was executed.
     */
-    template<typename Func>
-    inline void async(const Func& f) const
+    template<typename Func,
+             typename = typename std::enable_if<
+               !std::is_convertible<Func, operation_ptr>::value &&
+               !std::is_same<typename std::decay<Func>::type,
+                             unique_operation>::value>::type>
+    inline void async(Func&& f) const
     {
-        async(make_operation(f));
+        async(unique_operation(std::forward<Func>(f)));
     }
 
+    /**
+        @see async(operation_ptr).
+
+        Will dispatch all operations in the range [first, last) at once
+        which is considerably cheaper than queueing them one by one. The
+        range may hold anything accepted by async(), unique_operation
+        items are moved from the range while all other items are copied
+        unless the iterator yields rvalues, e.g. a std::move_iterator.
+        Single-pass input iterators are traversed only once.
+     */
+    template<typename Iterator>
+    inline void async_bulk(Iterator first, Iterator last) const
+    {
+        std::vector<unique_operation> ops;
+        reserve_bulk(
+          ops,
+          first,
+          last,
+          typename std::iterator_traits<Iterator>::iterator_category());
+        for (; first != last; ++first) {
+            ops.push_back(bulk_operation(*first));
+        }
+        async_bulk(std::move(ops));
+    }
+
+    /**
+        @see async_bulk(Iterator, Iterator).
+
+        Will take over all of the given operations.
+     */
+    void async_bulk(std::vector<unique_operation>&& ops) const;
+
     /**
         Applies the given iteration_operation for times execution
         in this queue and waits for all iterations of the operation to complete
        execution before returning.
 
+        Iterations are executed in chunks to reduce the scheduling
+        overhead, the calling thread may execute some of them as well.
+
         @param times The number of times the operation will be executed
+        @param grain The number of consecutive iterations to execute at once,
+                     pass 0 to have a suitable number chosen automatically
     */
-    void apply(size_t times, const iteration_operation_ptr& op) const;
+    void apply(size_t times,
+               const iteration_operation_ptr& op,
+               size_t grain = 0) const;
 
     /**
-        @see apply(sizee_t, iteration_operation_ptr).
+        @see apply(sizee_t, iteration_operation_ptr, size_t).
 
         Will wrap the given function in an operation and put it on the queue.
     */
     template<typename Func>
-    inline void apply(size_t times, const Func& f) const
+    inline void apply(size_t times, const Func& f, size_t grain = 0) const
     {
-        apply(times, make_iteration_operation(f));
+        apply(times, make_iteration_operation(f), grain);
     }
 
     /**
@@ -178,6 +234,35 @@ public:
     iqueue_impl_ptr implementation() const;
 
 private:
+    static inline unique_operation bulk_operation(unique_operation& op)
+    {
+        return std::move(op);
+    }
+
+    template<typename T>
+    static inline unique_operation bulk_operation(T&& item)
+    {
+        return unique_operation(std::forward<T>(item));
+    }
+
+    // the size of a range can only be determined upfront
+    // when it may be traversed more than once
+    template<typename Iterator>
+    static inline void reserve_bulk(std::vector<unique_operation>& ops,
+                                    Iterator first,
+                                    Iterator last,
+                                    std::forward_iterator_tag)
+    {
+        ops.reserve(static_cast<size_t>(std::distance(first, last)));
+    }
+
+    template<typename Iterator>
+    static inline void reserve_bulk(std::vector<unique_operation>&,
+                                    Iterator,
+                                    Iterator,
+                                    std::input_iterator_tag)
+    {}
+
     iqueue_impl_ptr m_impl;
     std::string m_label;
 };
@@ -38,20 +38,16 @@ set_debugger_threadname_from_queue()
     }
 }
 
+template<class Operation>
 void
-run_wrapper(operation_wrap* wrapper)
+run_operation(Operation& op)
 {
-    XDISPATCH_ASSERT(wrapper);
-
-    const operation_ptr& wrappedOp = wrapper->type();
-    XDISPATCH_ASSERT(wrappedOp);
-
 #if !(defined DEBUG)
     try
 #endif
     {
         set_debugger_threadname_from_queue();
-        execute_operation_on_this_thread(*wrappedOp);
+        execute_operation_on_this_thread(op);
     }
 #if !(defined DEBUG)
     catch (const std::exception& e) {
@@ -89,6 +85,26 @@ run_wrapper(operation_wrap* wrapper)
 #endif
 }
 
+void
+run_wrapper(operation_wrap* wrapper)
+{
+    XDISPATCH_ASSERT(wrapper);
+
+    const operation_ptr& wrappedOp = wrapper->type();
+    XDISPATCH_ASSERT(wrappedOp);
+    run_operation(*wrappedOp);
+}
+
+extern "C" void
+_xdispatch2_run_unique_delete(void* dt)
+{
+    XDISPATCH_ASSERT(dt);
+
+    std::unique_ptr<unique_operation> op(static_cast<unique_operation*>(dt));
+    XDISPATCH_ASSERT(*op);
+    run_operation(*op);
+}
+
 extern "C" void
 _xdispatch2_run_wrap_delete(void* dt)
 {
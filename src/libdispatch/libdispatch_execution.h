@@ -31,6 +31,9 @@ _xdispatch2_run_wrap(void*);
 void
 _xdispatch2_run_wrap_delete(void*);
 
+void
+_xdispatch2_run_unique_delete(void*);
+
 void
 _xdispatch2_run_iter_wrap(void*, size_t);
 }
@@ -39,7 +42,7 @@ __XDISPATCH_BEGIN_NAMESPACE
 namespace libdispatch {
 
 template<class T>
-class wrap_T
+class wrap_T : public pooled_allocation
 {
 public:
     explicit wrap_T(const std::shared_ptr<T>& t)
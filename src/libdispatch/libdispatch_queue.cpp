@@ -25,6 +25,8 @@
 #include "libdispatch_backend_internal.h"
 #include "libdispatch_execution.h"
 
+#include <algorithm>
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace libdispatch {
 
@@ -52,6 +54,13 @@ public:
           m_native, wrapper.release(), _xdispatch2_run_wrap_delete);
     }
 
+    void async_unique(unique_operation&& op) final
+    {
+        auto owned = std::make_unique<unique_operation>(std::move(op));
+        dispatch_async_f(
+          m_native, owned.release(), _xdispatch2_run_unique_delete);
+    }
+
     void apply(size_t times, const iteration_operation_ptr& op) final
     {
         iteration_operation_wrap wrap(op);
@@ -59,6 +68,25 @@ public:
         dispatch_apply_f(times, m_native, &wrap, _xdispatch2_run_iter_wrap);
     }
 
+    void apply_chunked(size_t times,
+                       const iteration_operation_ptr& op,
+                       size_t grain) final
+    {
+        // libdispatch is splitting the iterations by itself already
+        if (grain <= 1) {
+            apply(times, op);
+            return;
+        }
+
+        const auto chunks = (times + grain - 1) / grain;
+        apply(chunks, make_iteration_operation([op, times, grain](size_t c) {
+                  const auto end = std::min(times, (c + 1) * grain);
+                  for (auto i = c * grain; i < end; ++i) {
+                      execute_operation_on_this_thread(*op, i);
+                  }
+              }));
+    }
+
     void after(std::chrono::milliseconds delay, const operation_ptr& op) final
     {
         const auto time = dispatch_time(
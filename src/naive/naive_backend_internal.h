@@ -45,6 +45,11 @@ public:
      */
     virtual ithreadpool_ptr create_threadpool();
 
+    /**
+       @brief Creates a threadpool using the given configuration
+     */
+    ithreadpool_ptr create_threadpool(const threadpool_config& config);
+
     /**
        @copydoc ibackend::create_main_queue
      */
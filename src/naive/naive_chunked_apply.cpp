@@ -0,0 +1,117 @@
+/*
+ * naive_chunked_apply.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_chunked_apply.h"
+
+#include "../xdispatch_internal.h"
+#include "../thread_utils.h"
+
+#include <algorithm>
+#include <vector>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+// the number of chunks per processor when deriving the grain
+// so that threads finishing early can take over some work
+constexpr size_t kChunksPerThread = 4;
+// the number of times to check for chunks in progress on other
+// threads to complete before going to sleep
+constexpr int kSpinsBeforeWait = 1000;
+
+chunked_apply::chunked_apply(size_t times,
+                             const iteration_operation_ptr& op,
+                             size_t grain)
+  : m_op(op)
+  , m_times(times)
+  , m_grain(grain)
+  , m_next(0)
+  , m_pending(times)
+  , m_completed()
+{
+    XDISPATCH_ASSERT(m_grain > 0);
+}
+
+void
+chunked_apply::run(ithreadpool& pool,
+                   queue_priority priority,
+                   size_t times,
+                   const iteration_operation_ptr& op,
+                   size_t grain)
+{
+    if (0 == times) {
+        return;
+    }
+
+    const auto threads =
+      std::max<size_t>(thread_utils::system_thread_count(), 1);
+    if (0 == grain) {
+        grain = std::max<size_t>(times / (threads * kChunksPerThread), 1);
+    }
+    const auto chunks = (times + grain - 1) / grain;
+
+    auto apply = std::make_shared<chunked_apply>(times, op, grain);
+    const auto helpers = std::min(threads, chunks) - 1;
+    std::vector<unique_operation> work;
+    work.reserve(helpers);
+    for (size_t i = 0; i < helpers; ++i) {
+        work.emplace_back([apply] { apply->execute_chunks(); });
+    }
+    pool.execute_bulk(std::move(work), priority);
+    apply->execute_chunks();
+    apply->wait_for_chunks();
+}
+
+void
+chunked_apply::execute_chunks()
+{
+    for (;;) {
+        const auto begin = m_next.fetch_add(m_grain, std::memory_order_relaxed);
+        if (begin >= m_times) {
+            return;
+        }
+        const auto end = std::min(begin + m_grain, m_times);
+        for (auto i = begin; i < end; ++i) {
+            execute_operation_on_this_thread(*m_op, i);
+        }
+        const auto count = end - begin;
+        if (count == m_pending.fetch_sub(count, std::memory_order_acq_rel)) {
+            m_completed.complete();
+        }
+    }
+}
+
+void
+chunked_apply::wait_for_chunks()
+{
+    // all chunks have been claimed, the remaining ones are
+    // executing already and most likely about to complete
+    for (int spins = 0; spins < kSpinsBeforeWait; ++spins) {
+        if (0 == m_pending.load(std::memory_order_acquire)) {
+            return;
+        }
+        thread_utils::cpu_relax();
+    }
+    m_completed.wait();
+}
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
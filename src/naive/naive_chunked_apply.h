@@ -0,0 +1,92 @@
+/*
+ * naive_chunked_apply.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_CHUNKED_APPLY_H_
+#define XDISPATCH_NAIVE_CHUNKED_APPLY_H_
+
+#include "xdispatch/dispatch.h"
+#include "xdispatch/backend_naive_ithreadpool.h"
+#include "xdispatch/impl/lightweight_barrier.h"
+
+#include <atomic>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief Shares the iterations of an apply between threads
+
+    Iterations are split into chunks of grain iterations each. Every
+    participating thread claims the next chunk by advancing a shared
+    counter until all chunks have been claimed, i.e. threads finishing
+    their chunks early simply claim more of them. This way an apply costs
+    a single task per participating thread regardless of the number of
+    iterations.
+
+    The calling thread never sleeps while chunks are left to be claimed.
+    Once all of them have been claimed it only waits for the chunks still
+    executing on other threads. As these are running already the pool is
+    not told about the thread blocking and no additional thread needs to
+    be spawned, even when applies are nested.
+ */
+class chunked_apply
+{
+public:
+    /**
+        @brief Do not use, public to support std::make_shared
+     */
+    chunked_apply(size_t times,
+                  const iteration_operation_ptr& op,
+                  size_t grain);
+
+    /**
+        @brief Executes op for times iterations on the given pool and
+               blocks until all iterations have completed
+
+        The calling thread executes iterations as well, at most one
+        task per processor is queued to the pool.
+
+        @param grain The number of iterations claimed at once or 0 to
+                     derive a suitable number from the number of processors
+     */
+    static void run(ithreadpool& pool,
+                    queue_priority priority,
+                    size_t times,
+                    const iteration_operation_ptr& op,
+                    size_t grain);
+
+private:
+    void execute_chunks();
+    void wait_for_chunks();
+
+    const iteration_operation_ptr m_op;
+    const size_t m_times;
+    const size_t m_grain;
+    std::atomic<size_t> m_next;
+    // iterations not completed yet
+    std::atomic<size_t> m_pending;
+    lightweight_barrier m_completed;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif /* XDISPATCH_NAIVE_CHUNKED_APPLY_H_ */
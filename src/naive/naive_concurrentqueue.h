@@ -36,6 +36,23 @@ namespace naive {
 template<typename T>
 using concurrentqueue = ::moodycamel::ConcurrentQueue<T>;
 
+/**
+  Identifies a single thread enqueueing to a concurrentqueue, enqueueing
+  with a token avoids looking up the queue internal state of the thread.
+
+  A token must not outlive the queue it was created for.
+*/
+using producer_token = ::moodycamel::ProducerToken;
+
+/**
+  Identifies a single thread dequeueing from a concurrentqueue so that
+  consumers spread out over the producers instead of contending for
+  the same ones.
+
+  A token must not outlive the queue it was created for.
+*/
+using consumer_token = ::moodycamel::ConsumerToken;
+
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
 
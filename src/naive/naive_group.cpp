@@ -23,87 +23,244 @@
 #include "xdispatch/impl/iqueue_impl.h"
 
 #include "naive_backend_internal.h"
-#include "naive_consumable.h"
-#include "naive_operations.h"
 #include "naive_threadpool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
+// the lower half of the state counts the outstanding operations,
+// the upper half the number of times they all have completed
+static constexpr uint64_t kOutstandingMask = 0xffffffffULL;
+static constexpr uint64_t kOneGeneration = 1ULL << 32;
+
+static uint32_t
+generation_of(uint64_t state)
+{
+    return static_cast<uint32_t>(state >> 32);
+}
+
+/**
+    A group counting its outstanding operations in a single word
+
+    Whenever the count drops to zero the generation is incremented.
+    Waiting for all operations submitted so far is waiting for the
+    generation to change which takes no memory and constant time
+    however often wait() is called.
+
+    The group keeps itself alive while operations are outstanding
+    so that they do not need to hold a reference.
+ */
 class group_impl
   : public igroup_impl
   , public std::enable_shared_from_this<group_impl>
 {
 public:
-    group_impl(const ithreadpool_ptr& pool, backend_type backend)
+    explicit group_impl(backend_type backend)
       : igroup_impl()
-      , m_pool(pool)
       , m_backend(backend)
-      , m_consumable(std::make_shared<consumable>())
-    {}
+      , m_state(0)
+      , m_CS()
+      , m_cond()
+      , m_notifications()
+      , m_self()
+      , m_self_count(0)
+    {
+        XDISPATCH_ASSERT(m_state.is_lock_free());
+    }
 
     ~group_impl() override = default;
 
     void async(const operation_ptr& op, const iqueue_impl_ptr& q) final
     {
-        const auto c = std::atomic_load(&m_consumable);
-        XDISPATCH_ASSERT(c);
-        c->add_resource();
-        q->async(std::make_shared<consuming_operation>(op, c));
+        enter();
+        q->async_unique(unique_operation(member(op, this)));
     }
 
     bool wait(std::chrono::milliseconds timeout) final
     {
-        // swap the previous consumable with a new one that all operations
-        // submitted after this call will be added to and which waits on the
-        // previous consumable in a chain. Use a compare/exchange and retry
-        // whenever the consumable was already swapped by another thread
-        consumable_ptr old_c;
-        consumable_ptr new_c;
-        do {
-            old_c = std::atomic_load(&m_consumable);
-            new_c = std::make_shared<consumable>(0, old_c);
-        } while (
-          !std::atomic_compare_exchange_weak(&m_consumable, &old_c, new_c));
-        XDISPATCH_ASSERT(old_c);
-        XDISPATCH_ASSERT(new_c);
-        return old_c->wait_for_consumed(timeout);
+        const auto state = m_state.load(std::memory_order_acquire);
+        if (0 == (state & kOutstandingMask)) {
+            return true;
+        }
+        const auto generation = generation_of(state);
+        const auto completed = [this, generation] {
+            return generation !=
+                   generation_of(m_state.load(std::memory_order_acquire));
+        };
+        if (0 == timeout.count()) {
+            return completed();
+        }
+
+        ithreadpool::block_scope blocked;
+        std::unique_lock<std::mutex> lock(m_CS);
+        if (timeout.count() < 0) {
+            m_cond.wait(lock, completed);
+            return true;
+        }
+        return m_cond.wait_for(lock, timeout, completed);
 
         // FIXME(zwicker): This is blocking and will not work if invoked from
         // within
         //                 an operation active on the same queue as one of the
-        //                 operations listed in the consumable
+        //                 operations of the group
     }
 
     void notify(const operation_ptr& op, const iqueue_impl_ptr& q) final
     {
         XDISPATCH_ASSERT(q);
 
-        const auto this_ptr = shared_from_this();
-        auto notify_op = make_operation([op, q, this_ptr] {
-            // note: wait(..) will already notify the threadpool that
-            //       we are blocking one of its threads through our internal
-            //       use of a consumable
-            this_ptr->wait(std::chrono::milliseconds::max());
-            q->async(op);
-        });
-
-        // FIXME(zwicker): Add accessors to execute with the queue's priority
-        m_pool->execute(notify_op, queue_priority::DEFAULT);
+        // no thread is blocked, the operation completing last
+        // will queue the notification instead
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            const auto state = m_state.load(std::memory_order_acquire);
+            if (0 != (state & kOutstandingMask)) {
+                m_notifications.push_back(
+                  notification{ generation_of(state), op, q });
+                return;
+            }
+        }
+        q->async(op);
     }
 
     backend_type backend() final { return m_backend; }
 
 private:
-    const ithreadpool_ptr m_pool;
+    struct notification
+    {
+        uint32_t m_generation;
+        operation_ptr m_op;
+        iqueue_impl_ptr m_queue;
+    };
+
+    // executes an operation and leaves the group when done, stored
+    // inline by a unique_operation so that no memory is allocated
+    class member
+    {
+    public:
+        member(const operation_ptr& op, group_impl* group)
+          : m_op(op)
+          , m_group(group)
+        {}
+
+        member(member&& other) noexcept
+          : m_op(std::move(other.m_op))
+          , m_group(other.m_group)
+        {
+            other.m_group = nullptr;
+        }
+
+        member(const member&) = delete;
+        member& operator=(const member&) = delete;
+
+        ~member()
+        {
+            // dropped without being executed, e.g. when the queue was
+            // released. Leave anyway as the group would keep itself
+            // alive forever otherwise
+            if (m_group) {
+                m_group->leave();
+            }
+        }
+
+        void operator()()
+        {
+            execute_operation_on_this_thread(*m_op);
+
+            auto* const group = m_group;
+            m_group = nullptr;
+            group->leave();
+        }
+
+    private:
+        operation_ptr m_op;
+        // reset once the group was left
+        group_impl* m_group;
+    };
+
+    void enter()
+    {
+        const auto state = m_state.fetch_add(1, std::memory_order_acq_rel);
+        XDISPATCH_ASSERT((state & kOutstandingMask) < kOutstandingMask);
+        if (0 == (state & kOutstandingMask)) {
+            // the caller holds a reference so this is safe
+            std::lock_guard<std::mutex> lock(m_CS);
+            if (0 == m_self_count++) {
+                m_self = shared_from_this();
+            }
+        }
+    }
+
+    void leave()
+    {
+        // the last operation needs to start a new generation
+        // with the same operation that drops the count to zero
+        auto state = m_state.load(std::memory_order_relaxed);
+        uint64_t next = 0;
+        do {
+            XDISPATCH_ASSERT(0 != (state & kOutstandingMask));
+            next = state - 1;
+            if (0 == (next & kOutstandingMask)) {
+                next += kOneGeneration;
+            }
+        } while (!m_state.compare_exchange_weak(
+          state, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+        if (0 != (next & kOutstandingMask)) {
+            return;
+        }
+
+        // released last as this might be the final reference
+        std::shared_ptr<group_impl> self;
+        std::vector<notification> notifications;
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            m_cond.notify_all();
+
+            // notifications registered for later generations
+            // will be queued once those have completed
+            const auto generation = generation_of(state);
+            const auto later = std::partition(
+              m_notifications.begin(),
+              m_notifications.end(),
+              [generation](const notification& n) {
+                  return n.m_generation != generation;
+              });
+            std::move(
+              later, m_notifications.end(), std::back_inserter(notifications));
+            m_notifications.erase(later, m_notifications.end());
+
+            XDISPATCH_ASSERT(m_self_count > 0);
+            if (0 == --m_self_count) {
+                self.swap(m_self);
+            }
+        }
+        for (const auto& n : notifications) {
+            n.m_queue->async(n.m_op);
+        }
+    }
+
     const backend_type m_backend;
-    consumable_ptr m_consumable;
+    std::atomic<uint64_t> m_state;
+    std::mutex m_CS;
+    std::condition_variable m_cond;
+    std::vector<notification> m_notifications;
+    // held while operations are outstanding, every time the
+    // count goes up from zero the reference count is incremented
+    std::shared_ptr<group_impl> m_self;
+    size_t m_self_count;
 };
 
 igroup_impl_ptr
 backend::create_group(backend_type backend)
 {
-    return std::make_shared<group_impl>(global_threadpool(), backend);
+    return std::make_shared<group_impl>(backend);
 }
 
 } // namespace naive
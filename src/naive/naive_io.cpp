@@ -0,0 +1,288 @@
+/*
+ * naive_io.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_io_ring.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if (defined XDISPATCH2_HAVE_WINSOCK2)
+    #include <winsock2.h>
+#elif (defined XDISPATCH2_HAVE_SOCKETPAIR)
+    #include <sys/socket.h>
+#else
+    #error "naive_io is not supported on this platform"
+#endif
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+static std::atomic<bool> s_io_uring_enabled{ true };
+
+#if (defined XDISPATCH2_HAVE_WINSOCK2)
+static int
+last_error()
+{
+    const auto error = WSAGetLastError();
+    return WSAEWOULDBLOCK == error ? EAGAIN : error;
+}
+#else
+static int
+last_error()
+{
+    return EWOULDBLOCK == errno ? EAGAIN : errno;
+}
+#endif
+
+static io_result
+make_result(int64_t value)
+{
+    io_result result;
+    if (value < 0) {
+        result.error = last_error();
+    } else {
+        result.value = value;
+    }
+    return result;
+}
+
+/**
+    Waits for the socket to become ready and makes the actual call
+    using the given function afterwards until it does not report
+    EAGAIN anymore.
+ */
+template<typename Func>
+static void
+complete_when_ready(const queue& target,
+                    socket_t socket,
+                    notifier_type type,
+                    const Func& call,
+                    const io_operation_ptr& completion)
+{
+    // the notifier is kept alive by its own handler until the call
+    // completed, the holder breaks the cycle once this happened
+    auto holder = std::make_shared<std::shared_ptr<socket_notifier>>(
+      std::make_shared<socket_notifier>(socket, type, target));
+    auto& notifier = **holder;
+    notifier.handler([holder, call, completion](socket_t, notifier_type) {
+        if (!*holder) {
+            // completed already
+            return;
+        }
+        const auto result = call();
+        if (EAGAIN == result.error) {
+            return;
+        }
+        const auto self = std::move(*holder);
+        self->cancel();
+        execute_operation_on_this_thread(*completion, result);
+    });
+    notifier.resume();
+}
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+static io_ring*
+active_ring()
+{
+    return s_io_uring_enabled ? io_ring::instance() : nullptr;
+}
+
+static void
+submit(io_ring& ring,
+       io_ring::opcode opcode,
+       const queue& target,
+       socket_t socket,
+       char* buffer,
+       size_t size,
+       const io_operation_ptr& completion)
+{
+    ring.submit(io_ring::request_ptr(
+      new io_ring::request{ opcode,
+                            socket,
+                            buffer,
+                            size,
+                            target,
+                            completion,
+                            ring.buffer_index(buffer, size),
+                            false }));
+}
+#endif
+
+io_buffer::io_buffer(size_t size)
+  : m_data(nullptr)
+  , m_size(size)
+  , m_index(-1)
+{
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    if (auto* ring = io_ring::instance()) {
+        m_data = ring->acquire_buffer(size, m_index);
+    }
+#endif
+    if (nullptr == m_data) {
+        m_data = static_cast<char*>(malloc(size));
+        if (nullptr == m_data) {
+            throw std::bad_alloc();
+        }
+    }
+}
+
+io_buffer::~io_buffer()
+{
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    if (m_index >= 0) {
+        io_ring::instance()->release_buffer(m_index);
+        return;
+    }
+#endif
+    free(m_data);
+}
+
+void
+async_read(const queue& target,
+           socket_t socket,
+           char* buffer,
+           size_t size,
+           const io_operation_ptr& completion)
+{
+    XDISPATCH_ASSERT(completion);
+    queue_operation_with_d(*completion, target.implementation().get());
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    if (auto* ring = active_ring()) {
+        submit(*ring,
+               io_ring::opcode::READ,
+               target,
+               socket,
+               buffer,
+               size,
+               completion);
+        return;
+    }
+#endif
+    complete_when_ready(
+      target,
+      socket,
+      notifier_type::READ,
+      [socket, buffer, size] {
+          return make_result(recv(socket, buffer, static_cast<int>(size), 0));
+      },
+      completion);
+}
+
+void
+async_write(const queue& target,
+            socket_t socket,
+            const char* buffer,
+            size_t size,
+            const io_operation_ptr& completion)
+{
+    XDISPATCH_ASSERT(completion);
+    queue_operation_with_d(*completion, target.implementation().get());
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    if (auto* ring = active_ring()) {
+        // the buffer is never written to
+        submit(*ring,
+               io_ring::opcode::WRITE,
+               target,
+               socket,
+               const_cast<char*>(buffer),
+               size,
+               completion);
+        return;
+    }
+#endif
+#if (defined MSG_NOSIGNAL)
+    static constexpr int kFlags = MSG_NOSIGNAL;
+#else
+    static constexpr int kFlags = 0;
+#endif
+    complete_when_ready(
+      target,
+      socket,
+      notifier_type::WRITE,
+      [socket, buffer, size] {
+          return make_result(
+            send(socket, buffer, static_cast<int>(size), kFlags));
+      },
+      completion);
+}
+
+void
+async_accept(const queue& target,
+             socket_t socket,
+             const io_operation_ptr& completion)
+{
+    XDISPATCH_ASSERT(completion);
+    queue_operation_with_d(*completion, target.implementation().get());
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    if (auto* ring = active_ring()) {
+        submit(*ring,
+               io_ring::opcode::ACCEPT,
+               target,
+               socket,
+               nullptr,
+               0,
+               completion);
+        return;
+    }
+#endif
+    complete_when_ready(
+      target,
+      socket,
+      notifier_type::READ,
+      [socket] {
+          return make_result(
+            static_cast<int64_t>(accept(socket, nullptr, nullptr)));
+      },
+      completion);
+}
+
+void
+io_uring_enabled(bool enabled)
+{
+    s_io_uring_enabled = enabled;
+}
+
+bool
+io_uring_enabled()
+{
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+    return nullptr != active_ring();
+#else
+    return false;
+#endif
+}
+
+} // namespace naive
+
+// the completions are operations of their own parameter type
+template void
+queue_operation_with_d<naive::io_result>(naive::io_operation&, void*);
+
+template XDISPATCH_EXPORT void
+execute_operation_on_this_thread<naive::io_result>(naive::io_operation&,
+                                                   naive::io_result);
+
+__XDISPATCH_END_NAMESPACE
@@ -0,0 +1,480 @@
+/*
+ * naive_io_ring.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_io_ring.h"
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+
+    #include "../thread_utils.h"
+    #include "../trace_utils.h"
+
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+
+    #include <algorithm>
+    #include <cerrno>
+    #include <cstring>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+static constexpr unsigned kEntries = 256;
+static constexpr int kBufferCount = 32;
+static constexpr size_t kBufferSize = 16 * 1024;
+
+// user data of completions not belonging to a request
+static constexpr uint64_t kLinkedPoll = 0;
+static constexpr uint64_t kWakeupPoll = 1;
+
+template<typename T>
+static T*
+ring_field(void* ring, uint32_t offset)
+{
+    return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+io_ring*
+io_ring::instance()
+{
+    // remark: intentionally leak this object so that requests may
+    // still complete while other statics are destroyed
+    static auto* s_instance = []() -> io_ring* {
+        auto* ring = new io_ring;
+        if (!ring->setup()) {
+            XDISPATCH_TRACE() << "io_ring: io_uring is not available";
+            delete ring;
+            return nullptr;
+        }
+        ring->register_buffers();
+        ring->m_thread = std::thread(&io_ring::run, ring);
+        return ring;
+    }();
+    return s_instance;
+}
+
+void
+io_ring::submit(request_ptr&& r)
+{
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_pending.push_back(std::move(r));
+        if (!m_woken) {
+            m_woken = true;
+            wake = true;
+        }
+    }
+    if (wake) {
+        const uint64_t one = 1;
+        if (sizeof(one) != write(m_wakeup, &one, sizeof(one))) {
+            XDISPATCH_WARNING()
+              << "io_ring: Failed to wake ring: " << strerror(errno);
+        }
+    }
+}
+
+char*
+io_ring::acquire_buffer(size_t size, int& index)
+{
+    if (nullptr == m_buffers || size > kBufferSize) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_CS);
+    if (m_free_buffers.empty()) {
+        return nullptr;
+    }
+    index = m_free_buffers.back();
+    m_free_buffers.pop_back();
+    return m_buffers + index * kBufferSize;
+}
+
+void
+io_ring::release_buffer(int index)
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    m_free_buffers.push_back(index);
+}
+
+int
+io_ring::buffer_index(const char* data, size_t size) const
+{
+    if (nullptr == m_buffers || data < m_buffers ||
+        data >= m_buffers + kBufferCount * kBufferSize) {
+        return -1;
+    }
+    const auto index = static_cast<size_t>(data - m_buffers) / kBufferSize;
+    if (data + size > m_buffers + (index + 1) * kBufferSize) {
+        // spans multiple buffers
+        return -1;
+    }
+    return static_cast<int>(index);
+}
+
+io_ring::io_ring()
+  : m_fd(-1)
+  , m_wakeup(-1)
+  , m_params()
+  , m_sq_ring(MAP_FAILED)
+  , m_sq_ring_size(0)
+  , m_cq_ring(MAP_FAILED)
+  , m_cq_ring_size(0)
+  , m_sqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+  , m_sqes_size(0)
+  , m_sq_head(nullptr)
+  , m_sq_tail(nullptr)
+  , m_sq_mask(0)
+  , m_sq_array(nullptr)
+  , m_cq_head(nullptr)
+  , m_cq_tail(nullptr)
+  , m_cq_mask(0)
+  , m_cqes(nullptr)
+  , m_in_flight(0)
+  , m_ready()
+  , m_CS()
+  , m_pending()
+  , m_woken(false)
+  , m_buffers(nullptr)
+  , m_free_buffers()
+  , m_thread()
+{}
+
+io_ring::~io_ring()
+{
+    // only reached when the setup failed, the thread is not running
+    if (m_sqes != MAP_FAILED) {
+        munmap(m_sqes, m_sqes_size);
+    }
+    if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) {
+        munmap(m_cq_ring, m_cq_ring_size);
+    }
+    if (m_sq_ring != MAP_FAILED) {
+        munmap(m_sq_ring, m_sq_ring_size);
+    }
+    if (m_wakeup >= 0) {
+        close(m_wakeup);
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool
+io_ring::setup()
+{
+    m_fd = static_cast<int>(syscall(__NR_io_uring_setup, kEntries, &m_params));
+    if (m_fd < 0) {
+        return false;
+    }
+    if (0 == (m_params.features & IORING_FEAT_FAST_POLL)) {
+        // kernel too old to support the operations used
+        return false;
+    }
+
+    // make sure all operations used are supported
+    std::vector<char> probe_data(sizeof(io_uring_probe) +
+                                 IORING_OP_LAST * sizeof(io_uring_probe_op));
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_data.data());
+    if (syscall(__NR_io_uring_register,
+                m_fd,
+                IORING_REGISTER_PROBE,
+                probe,
+                IORING_OP_LAST) < 0) {
+        return false;
+    }
+    for (const auto op : { IORING_OP_RECV,
+                           IORING_OP_SEND,
+                           IORING_OP_ACCEPT,
+                           IORING_OP_READ_FIXED,
+                           IORING_OP_WRITE_FIXED,
+                           IORING_OP_POLL_ADD }) {
+        if (op > probe->last_op ||
+            0 == (probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+
+    m_sq_ring_size =
+      m_params.sq_off.array + m_params.sq_entries * sizeof(unsigned);
+    m_cq_ring_size =
+      m_params.cq_off.cqes + m_params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (m_params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) {
+        m_sq_ring_size = m_cq_ring_size =
+          std::max(m_sq_ring_size, m_cq_ring_size);
+    }
+
+    m_sq_ring = mmap(nullptr,
+                     m_sq_ring_size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE,
+                     m_fd,
+                     IORING_OFF_SQ_RING);
+    if (MAP_FAILED == m_sq_ring) {
+        return false;
+    }
+    if (single_mmap) {
+        m_cq_ring = m_sq_ring;
+    } else {
+        m_cq_ring = mmap(nullptr,
+                         m_cq_ring_size,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         m_fd,
+                         IORING_OFF_CQ_RING);
+        if (MAP_FAILED == m_cq_ring) {
+            return false;
+        }
+    }
+    m_sqes_size = m_params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe*>(mmap(nullptr,
+                                             m_sqes_size,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE,
+                                             m_fd,
+                                             IORING_OFF_SQES));
+    if (MAP_FAILED == m_sqes) {
+        return false;
+    }
+
+    m_sq_head =
+      ring_field<std::atomic<unsigned>>(m_sq_ring, m_params.sq_off.head);
+    m_sq_tail =
+      ring_field<std::atomic<unsigned>>(m_sq_ring, m_params.sq_off.tail);
+    m_sq_mask = *ring_field<unsigned>(m_sq_ring, m_params.sq_off.ring_mask);
+    m_sq_array = ring_field<unsigned>(m_sq_ring, m_params.sq_off.array);
+    m_cq_head =
+      ring_field<std::atomic<unsigned>>(m_cq_ring, m_params.cq_off.head);
+    m_cq_tail =
+      ring_field<std::atomic<unsigned>>(m_cq_ring, m_params.cq_off.tail);
+    m_cq_mask = *ring_field<unsigned>(m_cq_ring, m_params.cq_off.ring_mask);
+    m_cqes = ring_field<io_uring_cqe>(m_cq_ring, m_params.cq_off.cqes);
+
+    m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return m_wakeup >= 0;
+}
+
+void
+io_ring::register_buffers()
+{
+    void* memory = mmap(nullptr,
+                        kBufferCount * kBufferSize,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+    if (MAP_FAILED == memory) {
+        return;
+    }
+
+    std::vector<iovec> iovecs(kBufferCount);
+    for (int i = 0; i < kBufferCount; ++i) {
+        iovecs[i].iov_base = static_cast<char*>(memory) + i * kBufferSize;
+        iovecs[i].iov_len = kBufferSize;
+    }
+    if (syscall(__NR_io_uring_register,
+                m_fd,
+                IORING_REGISTER_BUFFERS,
+                iovecs.data(),
+                kBufferCount) < 0) {
+        // most likely exceeds the limit of locked memory
+        XDISPATCH_TRACE() << "io_ring: Failed to register buffers: "
+                          << strerror(errno);
+        munmap(memory, kBufferCount * kBufferSize);
+        return;
+    }
+
+    m_buffers = static_cast<char*>(memory);
+    for (int i = kBufferCount - 1; i >= 0; --i) {
+        m_free_buffers.push_back(i);
+    }
+}
+
+void
+io_ring::run()
+{
+    thread_utils::set_current_thread_name("de.emzeat.xdispatch2.io");
+    thread_utils::set_current_thread_priority(queue_priority::USER_INTERACTIVE);
+
+    bool wakeup_armed = false;
+    for (;;) {
+        if (!wakeup_armed) {
+            auto* sqe = next_sqe();
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = m_wakeup;
+            sqe->poll32_events = POLLIN;
+            sqe->user_data = kWakeupPoll;
+            ++m_in_flight;
+            wakeup_armed = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            for (auto& r : m_pending) {
+                m_ready.push_back(std::move(r));
+            }
+            m_pending.clear();
+            m_woken = false;
+        }
+
+        // every request occupies up to two entries, leave the remaining
+        // requests for later when running out of space in either queue
+        while (!m_ready.empty() && space() >= 2 &&
+               m_in_flight + 2 <= m_params.cq_entries) {
+            prepare(m_ready.front());
+            m_ready.pop_front();
+        }
+
+        // submit all entries prepared and wait for at least one completion
+        const auto tail = m_sq_tail->load(std::memory_order_relaxed);
+        const auto to_submit =
+          tail - m_sq_head->load(std::memory_order_acquire);
+        const auto ret = syscall(__NR_io_uring_enter,
+                                 m_fd,
+                                 to_submit,
+                                 1 /* min_complete */,
+                                 IORING_ENTER_GETEVENTS,
+                                 nullptr,
+                                 0);
+        if (ret < 0 && EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+            XDISPATCH_WARNING()
+              << "io_ring: io_uring_enter() failed: " << strerror(errno);
+        }
+
+        auto head = m_cq_head->load(std::memory_order_relaxed);
+        const auto cq_tail = m_cq_tail->load(std::memory_order_acquire);
+        for (; head != cq_tail; ++head) {
+            const auto& cqe = m_cqes[head & m_cq_mask];
+            --m_in_flight;
+            if (kWakeupPoll == cqe.user_data) {
+                uint64_t value = 0;
+                // reset the eventfd, the requests are picked up above
+                (void)read(m_wakeup, &value, sizeof(value));
+                wakeup_armed = false;
+            } else if (kLinkedPoll != cqe.user_data) {
+                complete(cqe);
+            }
+        }
+        m_cq_head->store(head, std::memory_order_release);
+    }
+}
+
+void
+io_ring::prepare(request_ptr& r)
+{
+    const bool read = io_ring::opcode::WRITE != r->m_opcode;
+    if (r->m_poll_first) {
+        auto* poll = next_sqe();
+        poll->opcode = IORING_OP_POLL_ADD;
+        poll->fd = r->m_socket;
+        poll->poll32_events = read ? POLLIN : POLLOUT;
+        poll->flags = IOSQE_IO_LINK;
+        poll->user_data = kLinkedPoll;
+        ++m_in_flight;
+    }
+
+    auto* sqe = next_sqe();
+    sqe->fd = r->m_socket;
+    switch (r->m_opcode) {
+        case io_ring::opcode::READ:
+            sqe->opcode =
+              r->m_buffer_index < 0 ? IORING_OP_RECV : IORING_OP_READ_FIXED;
+            break;
+        case io_ring::opcode::WRITE:
+            sqe->opcode =
+              r->m_buffer_index < 0 ? IORING_OP_SEND : IORING_OP_WRITE_FIXED;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            break;
+        case io_ring::opcode::ACCEPT:
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->accept_flags = SOCK_CLOEXEC;
+            break;
+    }
+    if (io_ring::opcode::ACCEPT != r->m_opcode) {
+        sqe->addr = reinterpret_cast<uintptr_t>(r->m_buffer);
+        sqe->len = static_cast<uint32_t>(r->m_size);
+    }
+    if (r->m_buffer_index >= 0) {
+        sqe->buf_index = static_cast<uint16_t>(r->m_buffer_index);
+        // sockets have no position
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->msg_flags = 0;
+    }
+    sqe->user_data = reinterpret_cast<uintptr_t>(r.release());
+    ++m_in_flight;
+}
+
+void
+io_ring::complete(const io_uring_cqe& cqe)
+{
+    request_ptr r(reinterpret_cast<request*>(cqe.user_data));
+
+    // the fixed operations do not wait for non-blocking sockets,
+    // submit again waiting for the socket to become ready first
+    if (-EAGAIN == cqe.res) {
+        r->m_poll_first = true;
+        m_ready.push_front(std::move(r));
+        return;
+    }
+
+    io_result result;
+    if (cqe.res < 0) {
+        result.error = -cqe.res;
+    } else {
+        result.value = cqe.res;
+    }
+    const auto completion = r->m_completion;
+    r->m_target.async([completion, result] {
+        execute_operation_on_this_thread(*completion, result);
+    });
+}
+
+io_uring_sqe*
+io_ring::next_sqe()
+{
+    // the tail is only written by this thread, the kernel
+    // picks up entries when io_uring_enter() is called
+    const auto tail = m_sq_tail->load(std::memory_order_relaxed);
+    const auto index = tail & m_sq_mask;
+    m_sq_array[index] = index;
+    auto* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    m_sq_tail->store(tail + 1, std::memory_order_release);
+    return sqe;
+}
+
+unsigned
+io_ring::space() const
+{
+    const auto used = m_sq_tail->load(std::memory_order_relaxed) -
+                      m_sq_head->load(std::memory_order_acquire);
+    return m_params.sq_entries - used;
+}
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif // XDISPATCH2_NAIVE_IO_RING
@@ -0,0 +1,173 @@
+/*
+ * naive_io_ring.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_IO_RING_H_
+#define XDISPATCH_NAIVE_IO_RING_H_
+
+#include "naive_backend_internal.h"
+
+#if (defined XDISPATCH2_HAVE_LINUX_IO_URING_H)
+
+    #include <linux/io_uring.h>
+
+    #include <atomic>
+    #include <cstdint>
+    #include <deque>
+    #include <memory>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+
+// all operations used are available starting with the same kernel
+// release which introduced fast polling of sockets
+    #if (defined IORING_FEAT_FAST_POLL)
+        #define XDISPATCH2_NAIVE_IO_RING 1
+    #endif
+
+#endif
+
+#if (defined XDISPATCH2_NAIVE_IO_RING)
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief Serves I/O requests using io_uring
+
+    Requests are handed to a single thread owning the ring. The thread
+    places all requests queued since it last woke into the submission
+    queue and submits them using a single system call. Completions are
+    dispatched to the target queue of the request.
+
+    A number of buffers is registered with the ring upfront. Reads and
+    writes operating on such buffers use the fixed variants of the
+    respective operations.
+ */
+class io_ring
+{
+public:
+    enum class opcode
+    {
+        READ,
+        WRITE,
+        ACCEPT
+    };
+
+    struct request
+    {
+        opcode m_opcode;
+        socket_t m_socket;
+        char* m_buffer;
+        size_t m_size;
+        queue m_target;
+        io_operation_ptr m_completion;
+        // index of the registered buffer or -1
+        int m_buffer_index;
+        // set to wait for the socket to become ready first
+        bool m_poll_first;
+    };
+    using request_ptr = std::unique_ptr<request>;
+
+    /**
+        @return The global ring or nullptr if io_uring is unavailable
+     */
+    static io_ring* instance();
+
+    /**
+        @brief Queues the request for submission
+
+        It is safe to call this function from multiple threads.
+     */
+    void submit(request_ptr&& r);
+
+    /**
+        @brief Takes a registered buffer holding at least size bytes
+
+        @return nullptr if no registered buffer is available
+     */
+    char* acquire_buffer(size_t size, int& index);
+
+    /**
+        @brief Returns a buffer taken using acquire_buffer()
+     */
+    void release_buffer(int index);
+
+    /**
+        @return The index of the registered buffer holding the given
+                memory or -1 if the memory is not registered
+     */
+    int buffer_index(const char* data, size_t size) const;
+
+private:
+    io_ring();
+    ~io_ring();
+
+    bool setup();
+    void register_buffers();
+
+    // the following are only used on the ring thread
+    void run();
+    void prepare(request_ptr& r);
+    void complete(const io_uring_cqe& cqe);
+    io_uring_sqe* next_sqe();
+    unsigned space() const;
+
+    int m_fd;
+    int m_wakeup;
+    io_uring_params m_params;
+
+    // the mapped rings
+    void* m_sq_ring;
+    size_t m_sq_ring_size;
+    void* m_cq_ring;
+    size_t m_cq_ring_size;
+    io_uring_sqe* m_sqes;
+    size_t m_sqes_size;
+    std::atomic<unsigned>* m_sq_head;
+    std::atomic<unsigned>* m_sq_tail;
+    unsigned m_sq_mask;
+    unsigned* m_sq_array;
+    std::atomic<unsigned>* m_cq_head;
+    std::atomic<unsigned>* m_cq_tail;
+    unsigned m_cq_mask;
+    io_uring_cqe* m_cqes;
+
+    // requests submitted but not completed yet
+    size_t m_in_flight;
+    std::deque<request_ptr> m_ready;
+
+    std::mutex m_CS;
+    std::vector<request_ptr> m_pending;
+    bool m_woken;
+
+    // the registered buffers
+    char* m_buffers;
+    std::vector<int> m_free_buffers;
+
+    std::thread m_thread;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif // XDISPATCH2_NAIVE_IO_RING
+
+#endif /* XDISPATCH_NAIVE_IO_RING_H_ */
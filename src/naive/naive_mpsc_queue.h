@@ -0,0 +1,217 @@
+/*
+ * naive_mpsc_queue.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_MPSC_QUEUE_H_
+#define XDISPATCH_NAIVE_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include "naive_backend_internal.h"
+#include "../thread_utils.h"
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief A lockfree multi-producer single-consumer FIFO queue
+
+    Items are stored in blocks of slots linked to each other. Producers
+    claim a slot by advancing the tail index and fill it afterwards, the
+    last producer of a block is in charge of linking the next one. The
+    consumer walks the blocks, releasing them once all slots were read. The
+    design is similar to the SegQueue of the crossbeam project.
+
+    Unlike the concurrentqueue used for the threadpool this keeps a strict
+    FIFO order across all producers as required by serial queues.
+
+    push() may be called from any thread, try_pop() only from one thread
+    at a time.
+ */
+template<typename T>
+class mpsc_queue
+{
+public:
+    mpsc_queue()
+      : m_tail(0)
+      , m_tail_block(new block)
+      , m_spare(nullptr)
+      , m_padding()
+      , m_head(0)
+      , m_head_block(m_tail_block.load(std::memory_order_relaxed))
+    {}
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    ~mpsc_queue()
+    {
+        T item;
+        while (try_pop(item)) {
+        }
+        delete m_head_block;
+        delete m_spare.load(std::memory_order_relaxed);
+    }
+
+    /**
+        @brief Appends the given item to the end of the queue
+     */
+    void push(T&& item)
+    {
+        auto tail = m_tail.load(std::memory_order_acquire);
+        auto* tail_block = m_tail_block.load(std::memory_order_acquire);
+        block* next_block = nullptr;
+
+        for (int spins = 0;; ++spins) {
+            const auto offset = tail % skLap;
+
+            // another producer is busy linking the next block
+            if (offset == skBlockCapacity) {
+                backoff(spins);
+                tail = m_tail.load(std::memory_order_acquire);
+                tail_block = m_tail_block.load(std::memory_order_acquire);
+                continue;
+            }
+
+            // allocate the next block before claiming the last slot so
+            // that other producers are not kept waiting for too long
+            if (offset + 1 == skBlockCapacity && nullptr == next_block) {
+                next_block = allocate_block();
+            }
+
+            if (m_tail.compare_exchange_weak(tail,
+                                             tail + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_acquire)) {
+                if (offset + 1 == skBlockCapacity) {
+                    m_tail_block.store(next_block, std::memory_order_release);
+                    m_tail.fetch_add(1, std::memory_order_release);
+                    tail_block->m_next.store(next_block,
+                                             std::memory_order_release);
+                } else if (next_block) {
+                    recycle_block(next_block);
+                }
+
+                auto& slot = tail_block->m_slots[offset];
+                new (&slot.m_storage) T(std::move(item));
+                slot.m_ready.store(true, std::memory_order_release);
+                return;
+            }
+
+            tail_block = m_tail_block.load(std::memory_order_acquire);
+        }
+    }
+
+    /**
+        @brief Removes the first item from the queue
+
+        @return false if the queue was empty
+     */
+    bool try_pop(T& item)
+    {
+        if (m_head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        // the slot has been claimed but its producer may still be busy
+        // filling it, this is a matter of a few instructions
+        const auto offset = m_head % skLap;
+        auto& slot = m_head_block->m_slots[offset];
+        for (int spins = 0; !slot.m_ready.load(std::memory_order_acquire);
+             ++spins) {
+            backoff(spins);
+        }
+
+        auto* value = reinterpret_cast<T*>(&slot.m_storage);
+        item = std::move(*value);
+        value->~T();
+        slot.m_ready.store(false, std::memory_order_relaxed);
+
+        if (offset + 1 == skBlockCapacity) {
+            // the producer of the last slot linked the next block
+            // before marking its slot as ready
+            auto* next = m_head_block->m_next.load(std::memory_order_acquire);
+            XDISPATCH_ASSERT(next);
+            recycle_block(m_head_block);
+            m_head_block = next;
+            m_head += 2;
+        } else {
+            ++m_head;
+        }
+        return true;
+    }
+
+private:
+    // the last offset in each lap is never used for an item
+    // but marks that the next block is being linked
+    static constexpr size_t skLap = 32;
+    static constexpr size_t skBlockCapacity = skLap - 1;
+
+    struct slot
+    {
+        std::atomic<bool> m_ready{ false };
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_storage;
+    };
+
+    struct block
+    {
+        std::atomic<block*> m_next{ nullptr };
+        slot m_slots[skBlockCapacity];
+    };
+
+    static void backoff(int spins)
+    {
+        if (spins < 64) {
+            thread_utils::cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    block* allocate_block()
+    {
+        auto* spare = m_spare.exchange(nullptr, std::memory_order_acquire);
+        return spare ? spare : new block;
+    }
+
+    void recycle_block(block* b)
+    {
+        // keep one block around so that a queue going through
+        // its blocks in steady state does not need to allocate
+        b->m_next.store(nullptr, std::memory_order_relaxed);
+        delete m_spare.exchange(b, std::memory_order_acq_rel);
+    }
+
+    std::atomic<size_t> m_tail;
+    std::atomic<block*> m_tail_block;
+    std::atomic<block*> m_spare;
+    // keeps the consumer side on a separate cache line
+    char m_padding[64];
+    size_t m_head;
+    block* m_head_block;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif /* XDISPATCH_NAIVE_MPSC_QUEUE_H_ */
@@ -0,0 +1,234 @@
+/*
+ * naive_numa_threadpool.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../trace_utils.h"
+
+#include "naive_threadpool.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#if (defined XDISPATCH2_HAVE_SCHED_GETCPU)
+    #include <sched.h>
+#endif
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+static constexpr auto kUnknownNode = std::numeric_limits<size_t>::max();
+
+/**
+    Parses a list of indices formatted like "0-3,8,10-11"
+ */
+static std::vector<int>
+parse_list(const std::string& list)
+{
+    std::vector<int> indices;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        const auto dash = range.find('-');
+        try {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = (std::string::npos == dash)
+                               ? first
+                               : std::stoi(range.substr(dash + 1));
+            for (int index = first; index <= last; ++index) {
+                indices.push_back(index);
+            }
+        } catch (const std::exception&) {
+            // skip anything not making sense, e.g. a trailing newline
+        }
+    }
+    return indices;
+}
+
+static std::string
+read_line(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+/**
+    @return the processors of each node, empty if unknown
+ */
+static std::vector<std::vector<int>>
+discover_nodes()
+{
+    static const std::string kNodes = "/sys/devices/system/node/";
+
+    std::vector<std::vector<int>> nodes;
+    for (const auto node : parse_list(read_line(kNodes + "online"))) {
+        auto processors = parse_list(read_line(
+          kNodes + "node" + std::to_string(node) + "/cpulist"));
+        // nodes holding memory only are of no use to us
+        if (!processors.empty()) {
+            nodes.push_back(std::move(processors));
+        }
+    }
+    return nodes;
+}
+
+static unsigned
+share_of(unsigned count, size_t nodes)
+{
+    return static_cast<unsigned>((count + nodes - 1) / nodes);
+}
+
+numa_threadpool::numa_threadpool(const threadpool_config& config)
+  : ithreadpool()
+  , m_nodes()
+  , m_processor_nodes()
+{
+    auto nodes = discover_nodes();
+    if (!config.affinity.empty()) {
+        for (auto& processors : nodes) {
+            processors.erase(
+              std::remove_if(processors.begin(),
+                             processors.end(),
+                             [&config](int processor) {
+                                 return config.affinity.end() ==
+                                        std::find(config.affinity.begin(),
+                                                  config.affinity.end(),
+                                                  processor);
+                             }),
+              processors.end());
+        }
+        nodes.erase(std::remove_if(nodes.begin(),
+                                   nodes.end(),
+                                   [](const std::vector<int>& processors) {
+                                       return processors.empty();
+                                   }),
+                    nodes.end());
+    }
+    if (nodes.empty()) {
+        XDISPATCH_TRACE() << "numa_threadpool: No nodes found, using one";
+        nodes.push_back(config.affinity);
+    }
+
+    for (const auto& processors : nodes) {
+        auto node_config = config;
+        node_config.numa = false;
+        node_config.affinity = processors;
+        node_config.min_threads = share_of(config.min_threads, nodes.size());
+        if (config.max_threads > 0) {
+            node_config.max_threads =
+              std::max(1U, share_of(config.max_threads, nodes.size()));
+        } else {
+            // overcommit the same way a single threadpool does
+            node_config.max_threads =
+              static_cast<unsigned>(2 * processors.size());
+        }
+        m_nodes.push_back(std::make_shared<threadpool>(node_config));
+
+        for (const auto processor : processors) {
+            const auto index = static_cast<size_t>(processor);
+            if (index >= m_processor_nodes.size()) {
+                m_processor_nodes.resize(index + 1, kUnknownNode);
+            }
+            m_processor_nodes[index] = m_nodes.size() - 1;
+        }
+    }
+    for (const auto& node : m_nodes) {
+        node->siblings(m_nodes);
+    }
+    XDISPATCH_TRACE() << "numa_threadpool with " << m_nodes.size()
+                      << " nodes";
+}
+
+void
+numa_threadpool::execute(const operation_ptr& work,
+                         const queue_priority priority)
+{
+    m_nodes[current_node()]->execute(work, priority);
+}
+
+void
+numa_threadpool::execute_unique(unique_operation&& work,
+                                const queue_priority priority)
+{
+    m_nodes[current_node()]->execute_unique(std::move(work), priority);
+}
+
+void
+numa_threadpool::execute_bulk(std::vector<unique_operation>&& work,
+                              const queue_priority priority)
+{
+    m_nodes[current_node()]->execute_bulk(std::move(work), priority);
+}
+
+size_t
+numa_threadpool::node_count() const
+{
+    return m_nodes.size();
+}
+
+std::shared_ptr<threadpool>
+numa_threadpool::node(size_t index) const
+{
+    XDISPATCH_ASSERT(index < m_nodes.size());
+    return m_nodes[index];
+}
+
+size_t
+numa_threadpool::current_node() const
+{
+    // workers stay on their node
+    const auto* current = ithreadpool::current();
+    for (size_t index = 0; index < m_nodes.size(); ++index) {
+        if (m_nodes[index].get() == current) {
+            return index;
+        }
+    }
+
+#if (defined XDISPATCH2_HAVE_SCHED_GETCPU)
+    const auto processor = sched_getcpu();
+    if (processor >= 0 &&
+        static_cast<size_t>(processor) < m_processor_nodes.size()) {
+        const auto index = m_processor_nodes[processor];
+        if (kUnknownNode != index) {
+            return index;
+        }
+    }
+#endif
+
+    // spread other threads evenly but keep each on the same node
+    return std::hash<std::thread::id>()(std::this_thread::get_id()) %
+           m_nodes.size();
+}
+
+void
+numa_threadpool::notify_thread_blocked()
+{}
+
+void
+numa_threadpool::notify_thread_unblocked()
+{}
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
@@ -22,20 +22,29 @@
 #include "naive_operation_queue.h"
 #include "naive_operation_queue_manager.h"
 #include "naive_thread.h"
-#include "naive_inverse_lockguard.h"
 
 #include "../thread_utils.h"
 #include "../trace_utils.h"
 
+#include <algorithm>
+#include <iterator>
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
 #define XDISPATCH_Q_TRACE(msg)                                                 \
     XDISPATCH_TRACE() << "Queue '" << m_label << "' " msg " ("                 \
-                      << m_jobs.size() << " jobs)"
+                      << m_pending << " jobs)"
 #define XDISPATCH_Q_WARNING(msg)                                               \
     XDISPATCH_WARNING() << "Queue '" << m_label << "' " msg " ("               \
-                        << m_jobs.size() << " jobs)"
+                        << m_pending << " jobs)"
+
+// the number of operations per drain used until the first drain
+// completed and their duration is known
+static constexpr size_t kInitialOpsPerDrain = 10;
+// reading the clock is not for free, the elapsed time
+// is only checked after this many operations
+static constexpr size_t kOpsPerClockCheck = 16;
 
 operation_queue::operation_queue(const ithreadpool_ptr& threadpool,
                                  const std::string& label,
@@ -43,12 +52,27 @@ operation_queue::operation_queue(const ithreadpool_ptr& threadpool,
   : m_label(label)
   , m_priority(priority)
   , m_jobs()
-  , m_CS()
+  , m_pending(0)
   , m_active_drain(false)
   , m_is_attached(false)
+  , m_is_released(false)
+  , m_local_jobs()
+  , m_local_next(0)
   , m_notify_operation(make_operation(this, &operation_queue::drain))
   , m_threadpool(threadpool)
-{}
+  , m_budget_duration(0)
+  , m_budget_operations(0)
+  , m_operations_per_drain(kInitialOpsPerDrain)
+  , m_drains(0)
+  , m_yields(0)
+{
+    budget(serial_queue_drain_budget());
+}
+
+// the queue whose jobs are executed by the current thread
+static thread_local const operation_queue* s_current_queue = nullptr;
+// the queue drained by the current thread
+static thread_local const operation_queue* s_draining_queue = nullptr;
 
 // helper to introduce a delay into a loop condition
 inline bool
@@ -60,60 +84,56 @@ yield_drain()
 
 operation_queue::~operation_queue()
 {
-    // ensure no new notifications can get queued
-    // wait for calls to drain() to return so that
-    // no dangling pointer access may happen on a different
-    // thread.
-    bool active_drain = false;
-    do {
-        std::lock_guard<std::mutex> lock(m_CS);
-        m_notify_operation.reset();
-        active_drain = m_active_drain;
+    // no new notifications get queued once the queue was released
+    // by the manager but wait for calls to drain() to return so that
+    // no dangling pointer access may happen on a different thread.
+    while (m_active_drain.load(std::memory_order_acquire) && yield_drain()) {
+        // delay to give other threads a chance to proceed
+        // if the drain is active
     }
-    // delay to give other threads a chance to proceed
-    // if the drain is active
-    while (active_drain && yield_drain());
 
     // release the threadpool
     m_threadpool.reset();
 }
 
-class drain_scope
+class current_scope
 {
 public:
-    drain_scope(bool& active_drain)
-      : m_active_drain(active_drain)
+    explicit current_scope(const operation_queue* queue)
+      : m_previous(s_current_queue)
     {
-        m_active_drain = true;
+        s_current_queue = queue;
     }
-    drain_scope(const drain_scope&) = delete;
+    current_scope(const current_scope&) = delete;
 
-    ~drain_scope() { m_active_drain = false; }
+    ~current_scope() { s_current_queue = m_previous; }
 
 private:
-    bool& m_active_drain;
+    const operation_queue* const m_previous;
 };
 
-class deferred_pop
+class drain_scope : public current_scope
 {
 public:
-    explicit deferred_pop(std::list<operation_ptr>& list, size_t& remaining)
-      : m_list(list)
-      , m_remaining(remaining)
-    {}
-    deferred_pop(const deferred_pop&) = delete;
+    drain_scope(const operation_queue* queue, std::atomic<bool>& active_drain)
+      : current_scope(queue)
+      , m_previous(s_draining_queue)
+      , m_active_drain(active_drain)
+    {
+        s_draining_queue = queue;
+        m_active_drain.store(true, std::memory_order_relaxed);
+    }
+    drain_scope(const drain_scope&) = delete;
 
-    ~deferred_pop()
+    ~drain_scope()
     {
-        XDISPATCH_ASSERT(m_remaining > 0);
-        XDISPATCH_ASSERT(!m_list.empty());
-        m_list.pop_front();
-        --m_remaining;
+        s_draining_queue = m_previous;
+        m_active_drain.store(false, std::memory_order_release);
     }
 
 private:
-    std::list<operation_ptr>& m_list;
-    size_t& m_remaining;
+    const operation_queue* const m_previous;
+    std::atomic<bool>& m_active_drain;
 };
 
 void
@@ -123,92 +143,248 @@ operation_queue::drain()
         thread_utils::set_current_thread_name(m_label);
     }
 
-    std::lock_guard<std::mutex> lock(m_CS);
-    drain_scope scope(m_active_drain);
+    drain_scope scope(this, m_active_drain);
     // we need to satisfy several constraints here:
-    // 1. do not remove the entry from m_jobs
-    //    until AFTER it has been executed so that async()
-    //    can test if all operations in m_jobs have COMPLETED
-    //    by checking if m_jobs is empty
-    // 2. make sure not to free an operation while m_CS is
-    //    locked so that recursive scenarios are supported
-    // 3. only execute a limited amount of operations to ensure
+    // 1. do not count a job as done until AFTER it has been
+    //    executed so that async() can test if all jobs have
+    //    COMPLETED by checking if m_pending was zero
+    // 2. only execute a limited amount of operations to ensure
     //    fair use of the draining thread in case jobs get
-    //    added quickly
-    static constexpr size_t kMaxOpsPerDrain = 10;
-    auto remaining = std::min(m_jobs.size(), kMaxOpsPerDrain);
-    while (0 != remaining) {
-        operation_ptr job;
-        deferred_pop pop(m_jobs, remaining);
-        std::swap(m_jobs.front(), job);
-        {
-            inverse_lock_guard<std::mutex> unlock(m_CS);
-            if (job) {
-                process_job(*job);
-                job.reset();
-            }
+    //    added quickly. The limit is derived from the time
+    //    the operations took on previous drains
+    // 3. jobs queued locally by the job which was executed
+    //    last are not counted, the count of the job queueing
+    //    them is held until all of them have been executed
+    m_drains.fetch_add(1, std::memory_order_relaxed);
+    const auto ops_per_drain =
+      m_operations_per_drain.load(std::memory_order_relaxed);
+    const auto duration = std::chrono::microseconds(
+      m_budget_duration.load(std::memory_order_relaxed));
+    const auto start = std::chrono::steady_clock::now();
+    size_t processed = 0;
+    while (processed < ops_per_drain) {
+        // there has to be a job as m_pending gets incremented only
+        // after the job has been pushed completely
+        unique_operation job;
+        if (!pop_local(job)) {
+            const bool popped = m_jobs.try_pop(job);
+            XDISPATCH_ASSERT(popped && job);
+        }
+        if (job) {
+            process_job(job);
+            job.reset();
+        }
+        ++processed;
+
+        if (m_local_next < m_local_jobs.size()) {
+            // local jobs are pending, keep holding the count
+        } else if (1 == m_pending.fetch_sub(1, std::memory_order_acq_rel)) {
+            // all jobs COMPLETED, the next call to async()
+            // will take care of notifying us again
+            adapt_budget(start, processed);
+            return;
+        }
+        if (m_is_released) {
+            XDISPATCH_Q_WARNING("detached, dropping operation");
+            return;
         }
+        if (0 == processed % kOpsPerClockCheck &&
+            std::chrono::steady_clock::now() - start > duration) {
+            // the operations became slower than on previous
+            // drains, stop early instead of using up the limit
+            break;
+        }
+    }
+
+    // not all jobs have been drained but to ensure fairness
+    // we do not continue but let others make use of our thread
+    // first. Queue another wakeup from here
+    adapt_budget(start, processed);
+    m_yields.fetch_add(1, std::memory_order_relaxed);
+    XDISPATCH_Q_TRACE("yield");
+    notify();
+}
+
+bool
+operation_queue::is_draining() const
+{
+    return this == s_draining_queue;
+}
+
+bool
+operation_queue::pop_local(unique_operation& job)
+{
+    if (m_local_next == m_local_jobs.size()) {
+        return false;
     }
-    if (!m_jobs.empty()) {
-        // not all jobs have been drained but to ensure fairness
-        // we do not continue but let others make use of our thread
-        // first. Queue another wakeup from here
-        XDISPATCH_Q_TRACE("yield");
-        notify_unsafe();
+    job = std::move(m_local_jobs[m_local_next++]);
+    if (m_local_next == m_local_jobs.size()) {
+        // keep the storage for the jobs queued by this one
+        m_local_jobs.clear();
+        m_local_next = 0;
     }
+    return true;
 }
 
 void
-operation_queue::notify_unsafe()
+operation_queue::adapt_budget(std::chrono::steady_clock::time_point start,
+                              size_t processed)
 {
-    if (m_notify_operation) {
-        XDISPATCH_Q_TRACE("notify");
-        m_threadpool->execute(m_notify_operation, m_priority);
-    } else {
-        XDISPATCH_Q_WARNING("detached, dropping operation");
+    using std::chrono::nanoseconds;
+    const auto elapsed = std::chrono::duration_cast<nanoseconds>(
+      std::chrono::steady_clock::now() - start);
+    const nanoseconds duration = std::chrono::microseconds(
+      m_budget_duration.load(std::memory_order_relaxed));
+    const auto limit = m_budget_operations.load(std::memory_order_relaxed);
+
+    // the number of operations which would have fit the duration
+    auto target = limit;
+    if (elapsed.count() > 0) {
+        const auto fitting = duration.count() *
+                             static_cast<nanoseconds::rep>(processed) /
+                             elapsed.count();
+        target = std::min(limit, static_cast<size_t>(fitting));
+    }
+    target = std::max<size_t>(1, target);
+
+    // shrink right away to stay fair but grow gradually
+    // so that a single burst of fast operations is not
+    // causing the queue to hog its thread
+    const auto current = m_operations_per_drain.load(std::memory_order_relaxed);
+    if (target > current) {
+        target = current + (target - current + 1) / 2;
     }
+    m_operations_per_drain.store(target, std::memory_order_relaxed);
+}
+
+void
+operation_queue::notify()
+{
+    XDISPATCH_Q_TRACE("notify");
+    m_threadpool->execute(m_notify_operation, m_priority);
+}
+
+void
+operation_queue::async(const operation_ptr& job)
+{
+    async(unique_operation(job));
 }
 
 void
-operation_queue::async_unsafe(operation_ptr&& job)
+operation_queue::async(unique_operation&& job)
 {
+    // queued by the job executing right now with no other job pending
+    // which could have been queued before. Executing the job next will
+    // keep the order without having to synchronize with other threads
+    if (is_draining() && 1 == m_pending.load(std::memory_order_acquire)) {
+        m_local_jobs.push_back(std::move(job));
+        return;
+    }
+
+    m_jobs.push(std::move(job));
+
     // we only need to notify, i.e. wake the thread
     // if all previous jobs have been COMPLETED. Elsewise
     // the thread is awake anyways and we can spare the overhead
-    const bool notify = m_jobs.empty();
-    m_jobs.push_back(std::move(job));
-    if (notify && m_is_attached) {
-        notify_unsafe();
+    const bool notify_required =
+      (0 == m_pending.fetch_add(1, std::memory_order_acq_rel));
+    if (notify_required && m_is_attached.load(std::memory_order_acquire)) {
+        notify();
     }
 }
 
 void
-operation_queue::async(const operation_ptr& job)
+operation_queue::async(std::vector<unique_operation>&& jobs)
 {
-    // preallocate outside the lock
-    operation_ptr job2 = job;
+    if (jobs.empty()) {
+        return;
+    }
+    if (is_draining() && 1 == m_pending.load(std::memory_order_acquire)) {
+        std::move(jobs.begin(), jobs.end(), std::back_inserter(m_local_jobs));
+        return;
+    }
+    for (auto& job : jobs) {
+        m_jobs.push(std::move(job));
+    }
+
+    // all jobs have been pushed completely before being counted
+    // so a single notification covers all of them
+    const bool notify_required =
+      (0 == m_pending.fetch_add(jobs.size(), std::memory_order_acq_rel));
+    if (notify_required && m_is_attached.load(std::memory_order_acquire)) {
+        notify();
+    }
+}
+
+bool
+operation_queue::try_execute(unique_operation& job)
+{
+    // we are executing a job of this queue already
+    if (is_current()) {
+        process_job(job);
+        return true;
+    }
+
+    // occupy the queue by accounting for a job without queueing it,
+    // no drain will be scheduled until this is released again
+    size_t idle = 0;
+    if (!m_pending.compare_exchange_strong(
+          idle, 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    class occupied_scope : public current_scope
+    {
+    public:
+        explicit occupied_scope(operation_queue* queue)
+          : current_scope(queue)
+          , m_queue(queue)
+        {}
+        occupied_scope(const occupied_scope&) = delete;
+
+        ~occupied_scope()
+        {
+            // jobs got queued meanwhile without a notification,
+            // have them drained the same way async() would do
+            const bool notify_required =
+              (1 != m_queue->m_pending.fetch_sub(1, std::memory_order_acq_rel));
+            if (notify_required &&
+                m_queue->m_is_attached.load(std::memory_order_acquire)) {
+                m_queue->notify();
+            }
+        }
+
+    private:
+        operation_queue* const m_queue;
+    };
+
+    occupied_scope scope(this);
+    process_job(job);
+    return true;
+}
 
-    std::lock_guard<std::mutex> lock(m_CS);
-    async_unsafe(std::move(job2));
+bool
+operation_queue::is_current() const
+{
+    return this == s_current_queue;
 }
 
 void
 operation_queue::attach()
 {
-    std::lock_guard<std::mutex> lock(m_CS);
-
     const auto this_ptr = shared_from_this();
     XDISPATCH_ASSERT(this_ptr);
     operation_queue_manager::instance().attach(this_ptr);
 
-    m_is_attached = true;
+    m_is_attached.store(true, std::memory_order_release);
 }
 
 void
 operation_queue::detach()
 {
-    std::lock_guard<std::mutex> lock(m_CS);
-    const auto empty = m_jobs.empty();
+    // the owner is the only one to queue jobs so no
+    // new jobs can show up while we are in here
+    const auto empty = (0 == m_pending.load(std::memory_order_acquire));
 
     if (empty) {
         // if there is no jobs remaining, there is no chance anymore for
@@ -221,18 +397,52 @@ operation_queue::detach()
         // all others which have been queued so far. The final
         // operation will make sure to unregister with the queue
         // manager and hence release the operation_queue
-        auto detach_op = make_operation(
-          [this] { operation_queue_manager::instance().detach(this); });
-        async_unsafe(std::move(detach_op));
+        async(unique_operation([this] {
+            m_is_released = true;
+            operation_queue_manager::instance().detach(this);
+        }));
     }
 
     // prevent any further notifications to be made for
     // jobs queued after detaching
-    m_is_attached = false;
+    m_is_attached.store(false, std::memory_order_release);
+}
+
+void
+operation_queue::budget(const serial_queue_drain_budget& budget)
+{
+    XDISPATCH_ASSERT(budget.operations > 0);
+    m_budget_duration.store(budget.duration.count(), std::memory_order_relaxed);
+    const auto limit = std::max<size_t>(1, budget.operations);
+    m_budget_operations.store(limit, std::memory_order_relaxed);
+    if (m_operations_per_drain.load(std::memory_order_relaxed) > limit) {
+        m_operations_per_drain.store(limit, std::memory_order_relaxed);
+    }
+}
+
+serial_queue_drain_budget
+operation_queue::budget() const
+{
+    serial_queue_drain_budget budget;
+    budget.duration = std::chrono::microseconds(
+      m_budget_duration.load(std::memory_order_relaxed));
+    budget.operations = m_budget_operations.load(std::memory_order_relaxed);
+    return budget;
+}
+
+serial_queue_statistics
+operation_queue::statistics() const
+{
+    serial_queue_statistics statistics;
+    statistics.operations_per_drain =
+      m_operations_per_drain.load(std::memory_order_relaxed);
+    statistics.drains = m_drains.load(std::memory_order_relaxed);
+    statistics.yields = m_yields.load(std::memory_order_relaxed);
+    return statistics;
 }
 
 void
-operation_queue::process_job(operation& job)
+operation_queue::process_job(unique_operation& job)
 {
 #if !(defined DEBUG)
     try
@@ -22,10 +22,12 @@
 #ifndef XDISPATCH_NAIVE_CONTEXTQUEUE_H_
 #define XDISPATCH_NAIVE_CONTEXTQUEUE_H_
 
-#include <list>
-#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
 
 #include "naive_backend_internal.h"
+#include "naive_mpsc_queue.h"
 
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
@@ -40,6 +42,9 @@ namespace naive {
     If an operation is queued it will be automatically dispatched
     onto the associated thread. Unnecessary thread wakeups will
     be optimized by not waking an already active thread again.
+    Queueing and draining operations is lockfree. Operations queued
+    by an operation of the same queue while no other operation is
+    pending bypass any synchronization and are executed next.
 
     As soon as the owner has no use for the operation_queue
     and also has no intend to queue operations to it anymore, it
@@ -75,6 +80,34 @@ public:
      */
     void async(const operation_ptr& job);
 
+    /**
+        @copydoc async(const operation_ptr&)
+     */
+    void async(unique_operation&& job);
+
+    /**
+        @brief Enqueues all of the passed jobs for async execution in the
+               queue, waking the associated thread at most once
+     */
+    void async(std::vector<unique_operation>&& jobs);
+
+    /**
+        @brief Executes the passed job on the calling thread right away
+               if this does not break the order of the queue
+
+        This is the case when called from within a job executing on this
+        queue or when the queue is idle. An idle queue is kept busy while
+        the job executes, jobs queued meanwhile are executed afterwards.
+
+        @return false if the queue was busy and the job was not executed
+     */
+    bool try_execute(unique_operation& job);
+
+    /**
+        @return true if the calling thread is executing a job of this queue
+     */
+    bool is_current() const;
+
     /**
         @brief Marks the queue as active
 
@@ -100,21 +133,51 @@ public:
      */
     void detach();
 
+    /**
+        @brief Changes the budget limiting a single drain of the queue
+     */
+    void budget(const serial_queue_drain_budget& budget);
+
+    /**
+        @return the budget limiting a single drain of the queue
+     */
+    serial_queue_drain_budget budget() const;
+
+    /**
+        @return statistics on the drains of the queue
+     */
+    serial_queue_statistics statistics() const;
+
 private:
     const std::string m_label;
     const queue_priority m_priority;
-    std::list<operation_ptr> m_jobs;
-    std::mutex m_CS;
-    bool m_active_drain;
-    bool m_is_attached;
-    operation_ptr m_notify_operation;
+    mpsc_queue<unique_operation> m_jobs;
+    // jobs queued but not COMPLETED yet
+    std::atomic<size_t> m_pending;
+    std::atomic<bool> m_active_drain;
+    std::atomic<bool> m_is_attached;
+    // only accessed from within drain()
+    bool m_is_released;
+    // jobs queued by the draining thread itself, executed before any
+    // other job is popped. Only accessed from within drain()
+    std::vector<unique_operation> m_local_jobs;
+    size_t m_local_next;
+    const operation_ptr m_notify_operation;
     ithreadpool_ptr m_threadpool;
+    std::atomic<int64_t> m_budget_duration;
+    std::atomic<size_t> m_budget_operations;
+    std::atomic<size_t> m_operations_per_drain;
+    std::atomic<uint64_t> m_drains;
+    std::atomic<uint64_t> m_yields;
 
     void drain();
-    void async_unsafe(operation_ptr&& job);
-    void notify_unsafe();
+    bool is_draining() const;
+    bool pop_local(unique_operation& job);
+    void notify();
+    void adapt_budget(std::chrono::steady_clock::time_point start,
+                      size_t processed);
 
-    static void process_job(operation& job);
+    static void process_job(unique_operation& job);
 };
 
 using operation_queue_ptr = std::shared_ptr<operation_queue>;
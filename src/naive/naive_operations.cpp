@@ -63,7 +63,8 @@ delayed_operation::create_and_dispatch(itimer_impl_ptr&& timer,
     //    cancel and release the timer hence breaking the circular
     //    ownership and ensuring a clean destruction sequence
 
-    auto delayed_op = std::make_shared<delayed_operation>(std::move(timer), op);
+    auto delayed_op =
+      make_pooled_operation<delayed_operation>(std::move(timer), op);
 
     delayed_op->m_timer->handler(delayed_op);
     delayed_op->m_timer->resume(delay);
@@ -92,21 +93,5 @@ delayed_operation::operator()()
     }
 }
 
-consuming_operation::consuming_operation(const operation_ptr& op,
-                                         const consumable_ptr& consumable)
-  : m_op(op)
-  , m_consumable(consumable)
-{}
-
-void
-consuming_operation::operator()()
-{
-    execute_operation_on_this_thread(*m_op);
-
-    if (m_consumable) {
-        m_consumable->consume_resource();
-    }
-}
-
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
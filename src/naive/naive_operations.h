@@ -92,29 +92,6 @@ private:
     const consumable_ptr m_consumable;
 };
 
-/**
-    @brief An operation notifying a consumable when done
- */
-class consuming_operation : public operation
-{
-public:
-    /**
-       @param op The operation to be executed
-       @param consumable The consumable to notify when done
-     */
-    consuming_operation(const operation_ptr& op,
-                        const consumable_ptr& consumable);
-
-    /**
-        @copydoc operation::operator()()
-     */
-    void operator()() final;
-
-private:
-    const operation_ptr m_op;
-    const consumable_ptr m_consumable;
-};
-
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
 
@@ -22,6 +22,7 @@
 #include "xdispatch/impl/iqueue_impl.h"
 
 #include "naive_backend_internal.h"
+#include "naive_chunked_apply.h"
 #include "naive_threadpool.h"
 #include "naive_operation_queue_manager.h"
 
@@ -55,13 +56,26 @@ public:
         m_pool->execute(op, m_priority);
     }
 
+    void async_unique(unique_operation&& op) final
+    {
+        m_pool->execute_unique(std::move(op), m_priority);
+    }
+
+    void async_bulk(std::vector<unique_operation>&& ops) final
+    {
+        m_pool->execute_bulk(std::move(ops), m_priority);
+    }
+
     void apply(size_t times, const iteration_operation_ptr& op) final
     {
-        const auto completed = std::make_shared<consumable>(times);
-        for (size_t i = 0; i < times; ++i) {
-            async(std::make_shared<apply_operation>(i, op, completed));
-        }
-        completed->wait_for_consumed();
+        apply_chunked(times, op, 0);
+    }
+
+    void apply_chunked(size_t times,
+                       const iteration_operation_ptr& op,
+                       size_t grain) final
+    {
+        chunked_apply::run(*m_pool, m_priority, times, op, grain);
     }
 
     void after(std::chrono::milliseconds delay, const operation_ptr& op) final
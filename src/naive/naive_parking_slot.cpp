@@ -0,0 +1,146 @@
+/*
+ * naive_parking_slot.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_parking_slot.h"
+
+#if (defined XDISPATCH2_NAIVE_PARKING_SLOT_FUTEX)
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    #include <ctime>
+#endif
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+#if (defined XDISPATCH2_NAIVE_PARKING_SLOT_FUTEX)
+
+static long
+futex(uint32_t* word, int op, uint32_t value, const timespec* timeout)
+{
+    return syscall(SYS_futex, word, op, value, timeout, nullptr, 0);
+}
+
+parking_slot::parking_slot()
+  : m_state(EMPTY)
+{
+    static_assert(sizeof(m_state) == sizeof(uint32_t),
+                  "The state must be usable as futex");
+    XDISPATCH_ASSERT(m_state.is_lock_free());
+}
+
+uint32_t*
+parking_slot::futex_word()
+{
+    return reinterpret_cast<uint32_t*>(&m_state);
+}
+
+bool
+parking_slot::park(std::chrono::milliseconds timeout)
+{
+    uint32_t expected = EMPTY;
+    if (!m_state.compare_exchange_strong(expected,
+                                         PARKED,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+        // woken before we even got to block
+        XDISPATCH_ASSERT(NOTIFIED == expected);
+        m_state.store(EMPTY, std::memory_order_relaxed);
+        return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        const auto remaining =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+        timespec relative{};
+        relative.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+        relative.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+
+        // returns right away if no longer parked
+        futex(futex_word(), FUTEX_WAIT_PRIVATE, PARKED, &relative);
+        if (NOTIFIED == m_state.load(std::memory_order_acquire)) {
+            m_state.store(EMPTY, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // a wakeup might still race with the timeout
+    expected = PARKED;
+    if (m_state.compare_exchange_strong(expected,
+                                        EMPTY,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+        return false;
+    }
+    m_state.store(EMPTY, std::memory_order_relaxed);
+    return true;
+}
+
+void
+parking_slot::unpark()
+{
+    if (PARKED == m_state.exchange(NOTIFIED, std::memory_order_acq_rel)) {
+        futex(futex_word(), FUTEX_WAKE_PRIVATE, 1, nullptr);
+    }
+}
+
+#else
+
+parking_slot::parking_slot()
+  : m_state(EMPTY)
+  , m_CS()
+  , m_cond()
+{}
+
+bool
+parking_slot::park(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_CS);
+    if (NOTIFIED != m_state) {
+        m_state = PARKED;
+        m_cond.wait_for(lock, timeout, [this] { return NOTIFIED == m_state; });
+    }
+    const bool notified = (NOTIFIED == m_state);
+    m_state = EMPTY;
+    return notified;
+}
+
+void
+parking_slot::unpark()
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    const bool parked = (PARKED == m_state);
+    m_state = NOTIFIED;
+    if (parked) {
+        m_cond.notify_one();
+    }
+}
+
+#endif // XDISPATCH2_NAIVE_PARKING_SLOT_FUTEX
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
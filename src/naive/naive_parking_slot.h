@@ -0,0 +1,97 @@
+/*
+ * naive_parking_slot.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_PARKING_SLOT_H_
+#define XDISPATCH_NAIVE_PARKING_SLOT_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "naive_backend_internal.h"
+
+// block using futexes directly whenever available
+#if (defined XDISPATCH2_HAVE_LINUX_FUTEX_H)
+    #define XDISPATCH2_NAIVE_PARKING_SLOT_FUTEX 1
+#endif
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief A place for a single thread to block until it is
+           explicitly woken by another thread
+
+    Different from a semaphore shared by many threads this allows
+    to pick the exact thread which is to be woken. A wakeup issued
+    while the owner is not parked is remembered and makes the
+    next call to park() return right away.
+ */
+class parking_slot
+{
+public:
+    parking_slot();
+
+    parking_slot(const parking_slot&) = delete;
+    parking_slot& operator=(const parking_slot&) = delete;
+
+    /**
+        @brief Blocks the calling thread until unpark() is called
+
+        Must only be called by the thread owning the slot.
+
+        @param timeout The maximum time to block
+
+        @return true if woken by unpark() or false if the timeout
+                was reached first
+     */
+    bool park(std::chrono::milliseconds timeout);
+
+    /**
+        @brief Wakes the thread parked in this slot
+     */
+    void unpark();
+
+private:
+    enum state : uint32_t
+    {
+        EMPTY = 0,
+        PARKED = 1,
+        NOTIFIED = 2
+    };
+
+#if (defined XDISPATCH2_NAIVE_PARKING_SLOT_FUTEX)
+    uint32_t* futex_word();
+
+    std::atomic<uint32_t> m_state;
+#else
+    uint32_t m_state;
+    std::mutex m_CS;
+    std::condition_variable m_cond;
+#endif
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif /* XDISPATCH_NAIVE_PARKING_SLOT_H_ */
@@ -0,0 +1,255 @@
+/*
+ * naive_reactor.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_reactor.h"
+
+#if (defined XDISPATCH2_HAVE_EPOLL)
+
+    #include "../thread_utils.h"
+    #include "../trace_utils.h"
+
+    #include <sys/epoll.h>
+    #include <unistd.h>
+
+    #include <array>
+    #include <cerrno>
+    #include <cstring>
+    #include <utility>
+    #include <vector>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+static constexpr uint32_t kReadEvents = EPOLLIN | EPOLLRDHUP;
+static constexpr uint32_t kWriteEvents = EPOLLOUT;
+static constexpr uint32_t kErrorEvents = EPOLLERR | EPOLLHUP;
+
+static size_t
+slot_index(notifier_type type)
+{
+    return notifier_type::READ == type ? 0 : 1;
+}
+
+void
+reactor::add(socket_t socket,
+             notifier_type type,
+             notifier_trigger trigger,
+             const watcher_ptr& w)
+{
+    XDISPATCH_ASSERT(w);
+
+    std::lock_guard<std::mutex> lock(m_CS);
+    auto& s = m_registrations[socket].m_slots[slot_index(type)];
+    if (s.m_owner && s.m_owner != w.get() && !s.m_watcher.expired()) {
+        XDISPATCH_WARNING() << "reactor: Replacing watcher of socket "
+                            << socket;
+    }
+    s.m_watcher = w;
+    s.m_owner = w.get();
+    s.m_trigger = trigger;
+    s.m_armed = false;
+}
+
+bool
+reactor::arm(socket_t socket, notifier_type type)
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    const auto it = m_registrations.find(socket);
+    if (it == m_registrations.end()) {
+        return false;
+    }
+    it->second.m_slots[slot_index(type)].m_armed = true;
+    return update(socket, it->second);
+}
+
+void
+reactor::disarm(socket_t socket, notifier_type type)
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    const auto it = m_registrations.find(socket);
+    if (it == m_registrations.end()) {
+        return;
+    }
+    auto& s = it->second.m_slots[slot_index(type)];
+    if (s.m_armed) {
+        s.m_armed = false;
+        update(socket, it->second);
+    }
+}
+
+void
+reactor::remove(socket_t socket, notifier_type type, const watcher* w)
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    const auto it = m_registrations.find(socket);
+    if (it == m_registrations.end()) {
+        return;
+    }
+    auto& r = it->second;
+    auto& s = r.m_slots[slot_index(type)];
+    if (s.m_owner != w) {
+        // replaced by another watcher meanwhile
+        return;
+    }
+    s = slot();
+
+    if (r.m_slots[0].m_owner || r.m_slots[1].m_owner) {
+        update(socket, r);
+        return;
+    }
+    if (r.m_added) {
+        // the socket might have been closed already which
+        // implicitly removed it from the epoll set, ignore errors
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr);
+    }
+    m_registrations.erase(it);
+}
+
+reactor&
+reactor::instance()
+{
+    // remark: intentionally leak this object so that notifiers may
+    // still be used while other statics are destroyed
+    static auto* s_instance = new reactor;
+    return *s_instance;
+}
+
+reactor::reactor()
+  : m_CS()
+  , m_epoll(epoll_create1(EPOLL_CLOEXEC))
+  , m_registrations()
+  , m_thread()
+{
+    if (m_epoll < 0) {
+        XDISPATCH_WARNING() << "reactor: epoll_create1() failed: "
+                            << strerror(errno);
+        return;
+    }
+    m_thread = std::thread(&reactor::run, this);
+}
+
+bool
+reactor::update(socket_t socket, registration& r)
+{
+    epoll_event ev{};
+    ev.events = EPOLLET;
+    if (r.m_slots[slot_index(notifier_type::READ)].m_armed) {
+        ev.events |= kReadEvents;
+    }
+    if (r.m_slots[slot_index(notifier_type::WRITE)].m_armed) {
+        ev.events |= kWriteEvents;
+    }
+    ev.data.fd = socket;
+
+    if (r.m_added) {
+        if (0 == epoll_ctl(m_epoll, EPOLL_CTL_MOD, socket, &ev)) {
+            return true;
+        }
+        if (ENOENT != errno) {
+            XDISPATCH_WARNING() << "reactor: Failed to modify socket "
+                                << socket << ": " << strerror(errno);
+            return false;
+        }
+        // the socket was closed and opened again meanwhile
+    }
+    if (0 != epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &ev)) {
+        XDISPATCH_WARNING() << "reactor: Socket " << socket
+                            << " cannot be watched: " << strerror(errno);
+        r.m_added = false;
+        return false;
+    }
+    r.m_added = true;
+    return true;
+}
+
+void
+reactor::run()
+{
+    thread_utils::set_current_thread_name("de.emzeat.xdispatch2.reactor");
+    thread_utils::set_current_thread_priority(queue_priority::USER_INTERACTIVE);
+
+    static constexpr int kMaxEvents = 64;
+    std::array<epoll_event, kMaxEvents> events{};
+    std::vector<std::pair<watcher_ptr, notifier_type>> ready;
+    ready.reserve(kMaxEvents);
+
+    for (;;) {
+        const int count =
+          epoll_wait(m_epoll, events.data(), kMaxEvents, -1 /* infinite */);
+        if (count < 0) {
+            if (EINTR != errno) {
+                XDISPATCH_WARNING()
+                  << "reactor: epoll_wait() failed: " << strerror(errno);
+            }
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            for (int i = 0; i < count; ++i) {
+                const auto socket = events[i].data.fd;
+                const auto flags = events[i].events;
+                const auto it = m_registrations.find(socket);
+                if (it == m_registrations.end()) {
+                    // removed while the event was pending
+                    continue;
+                }
+
+                auto& r = it->second;
+                bool disarmed = false;
+                for (const auto type :
+                     { notifier_type::READ, notifier_type::WRITE }) {
+                    auto& s = r.m_slots[slot_index(type)];
+                    const auto wanted = notifier_type::READ == type
+                                          ? kReadEvents
+                                          : kWriteEvents;
+                    if (!s.m_armed || 0 == (flags & (wanted | kErrorEvents))) {
+                        continue;
+                    }
+                    auto w = s.m_watcher.lock();
+                    if (!w) {
+                        continue;
+                    }
+                    if (notifier_trigger::LEVEL == s.m_trigger) {
+                        // armed again once the socket was serviced
+                        s.m_armed = false;
+                        disarmed = true;
+                    }
+                    ready.emplace_back(std::move(w), type);
+                }
+                if (disarmed) {
+                    update(socket, r);
+                }
+            }
+        }
+
+        // no lock held so that watchers may call back into the reactor
+        for (const auto& r : ready) {
+            r.first->ready(r.second);
+        }
+        ready.clear();
+    }
+}
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif // XDISPATCH2_HAVE_EPOLL
@@ -0,0 +1,138 @@
+/*
+ * naive_reactor.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_REACTOR_H_
+#define XDISPATCH_NAIVE_REACTOR_H_
+
+#include "naive_backend_internal.h"
+
+#if (defined XDISPATCH2_HAVE_EPOLL)
+
+    #include <memory>
+    #include <mutex>
+    #include <thread>
+    #include <unordered_map>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief Multiplexes the readiness of any number of sockets
+
+    All sockets are watched by a single epoll instance serviced by one
+    thread. Sockets are registered edge-triggered, level-triggered
+    watches are emulated by disarming the watch once it fired so that
+    it can be armed again after the socket was serviced. Arming a watch
+    evaluates the socket's readiness anew so that a socket which is
+    still ready will fire again right away.
+ */
+class reactor
+{
+public:
+    /**
+        @brief Receives the readiness of a socket
+     */
+    class watcher
+    {
+    public:
+        virtual ~watcher() = default;
+
+        /**
+            @brief Invoked on the reactor thread when the socket is ready
+
+            Implementations must not block but only dispatch the actual
+            work to a queue.
+         */
+        virtual void ready(notifier_type type) = 0;
+    };
+    using watcher_ptr = std::shared_ptr<watcher>;
+
+    /**
+        @brief Registers a watcher for the given socket and type
+
+        The watch will be disarmed initially. Only a single watcher can
+        be registered per socket and type, a later registration replaces
+        an earlier one.
+     */
+    void add(socket_t socket,
+             notifier_type type,
+             notifier_trigger trigger,
+             const watcher_ptr& w);
+
+    /**
+        @brief Starts delivering the readiness of the socket
+
+        @return false if the socket cannot be watched
+     */
+    bool arm(socket_t socket, notifier_type type);
+
+    /**
+        @brief Stops delivering the readiness of the socket
+     */
+    void disarm(socket_t socket, notifier_type type);
+
+    /**
+        @brief Unregisters the given watcher from the socket
+
+        Safe to call from within the destructor of the watcher.
+     */
+    void remove(socket_t socket, notifier_type type, const watcher* w);
+
+    /**
+        @return The global instance of the reactor
+     */
+    static reactor& instance();
+
+private:
+    reactor();
+
+    struct slot
+    {
+        std::weak_ptr<watcher> m_watcher;
+        // identifies the watcher even while it is being destroyed
+        const watcher* m_owner = nullptr;
+        notifier_trigger m_trigger = notifier_trigger::LEVEL;
+        bool m_armed = false;
+    };
+
+    struct registration
+    {
+        slot m_slots[2];
+        bool m_added = false;
+    };
+
+    // needs to be called with m_CS held
+    bool update(socket_t socket, registration& r);
+
+    void run();
+
+    std::mutex m_CS;
+    const int m_epoll;
+    std::unordered_map<socket_t, registration> m_registrations;
+    std::thread m_thread;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif // XDISPATCH2_HAVE_EPOLL
+
+#endif /* XDISPATCH_NAIVE_REACTOR_H_ */
@@ -24,9 +24,128 @@
 #include "naive_semaphore.h"
 #include "../thread_utils.h"
 
+#if (defined XDISPATCH2_NAIVE_SEMAPHORE_FUTEX)
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+    #include <algorithm>
+    #include <cerrno>
+    #include <ctime>
+#endif
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
+#if (defined XDISPATCH2_NAIVE_SEMAPHORE_FUTEX)
+
+static constexpr uint64_t kCountMask = 0xffffffffULL;
+static constexpr uint64_t kOneWaiter = 1ULL << 32;
+
+static long
+futex(uint32_t* word, int op, uint32_t value, const timespec* timeout)
+{
+    return syscall(SYS_futex, word, op, value, timeout, nullptr, 0);
+}
+
+semaphore::semaphore(int count)
+  : m_state(static_cast<uint64_t>(count))
+{
+    XDISPATCH_ASSERT(count >= 0);
+    XDISPATCH_ASSERT(m_state.is_lock_free());
+}
+
+uint32_t*
+semaphore::futex_word()
+{
+    auto* word = reinterpret_cast<uint32_t*>(&m_state);
+    #if (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return word + 1;
+    #else
+    return word;
+    #endif
+}
+
+int
+semaphore::available() const
+{
+    return static_cast<int>(m_state.load(std::memory_order_relaxed) &
+                            kCountMask);
+}
+
+bool
+semaphore::try_acquire()
+{
+    auto old_state = m_state.load(std::memory_order_relaxed);
+    do {
+        if (0 == (old_state & kCountMask)) {
+            return false;
+        }
+        if (m_state.compare_exchange_weak(
+              old_state, old_state - 1, std::memory_order_seq_cst)) {
+            return true;
+        }
+        // compare exchange failed, old_state was updated with the actual value
+    } while (true);
+}
+
+bool
+semaphore::wait_acquire(std::chrono::milliseconds timeout)
+{
+    if (try_acquire()) {
+        return true;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    m_state.fetch_add(kOneWaiter, std::memory_order_seq_cst);
+    for (;;) {
+        // acquire and stop waiting with a single operation
+        auto old_state = m_state.load(std::memory_order_relaxed);
+        while (0 != (old_state & kCountMask)) {
+            if (m_state.compare_exchange_weak(old_state,
+                                              old_state - 1 - kOneWaiter,
+                                              std::memory_order_seq_cst)) {
+                return true;
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        const auto remaining =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+        timespec relative{};
+        relative.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+        relative.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+
+        // returns right away if the count is not zero anymore
+        futex(futex_word(), FUTEX_WAIT_PRIVATE, 0, &relative);
+    }
+    m_state.fetch_sub(kOneWaiter, std::memory_order_seq_cst);
+    return false;
+}
+
+void
+semaphore::release(int count)
+{
+    XDISPATCH_ASSERT(count > 0);
+    const auto old_state = m_state.fetch_add(static_cast<uint64_t>(count),
+                                             std::memory_order_seq_cst);
+
+    // if there is waiters we should notify them
+    const auto waiters = old_state >> 32;
+    if (0 != waiters) {
+        const auto wake = std::min<uint64_t>(waiters, count);
+        futex(futex_word(),
+              FUTEX_WAKE_PRIVATE,
+              static_cast<uint32_t>(wake),
+              nullptr);
+    }
+}
+
+#else
+
 semaphore::semaphore(int count)
   : m_count(count)
   , m_waiters(0)
@@ -37,6 +156,12 @@ semaphore::semaphore(int count)
     XDISPATCH_ASSERT(m_waiters.is_lock_free());
 }
 
+int
+semaphore::available() const
+{
+    return m_count.load(std::memory_order_consume);
+}
+
 bool
 semaphore::try_acquire()
 {
@@ -59,34 +184,6 @@ semaphore::try_acquire()
     } while (true);
 }
 
-bool
-semaphore::spin_acquire(int spins)
-{
-    for (int i = 0; i < spins; ++i) {
-        if (try_acquire()) {
-            return true;
-        }
-
-        // note discussions linked at
-        // https://en.cppreference.com/w/cpp/atomic/atomic_flag most notably
-        // https://www.realworldtech.com/forum/?threadid=189711&curpostid=189723
-        // which comes to the conclusion that doing sched_yield may be far from
-        // ideal on SMP systems and actually be worse than suspending the thread
-        // on a mutex especially considering this involves a syscall.
-        //
-        // So instead try to follow
-        // https://www.realworldtech.com/forum/?threadid=189711&curpostid=189755
-        // which basically suggests to do a plain read + relax operation instead
-        // to avoid stumping on cache lines while just waiting on the counter to
-        // be increased.
-        while (0 == m_count.load(std::memory_order_consume) && i < spins) {
-            thread_utils::cpu_relax();
-            ++i;
-        }
-    }
-    return false;
-}
-
 bool
 semaphore::wait_acquire(std::chrono::milliseconds timeout)
 {
@@ -137,5 +234,35 @@ semaphore::release(int count)
     }
 }
 
+#endif // XDISPATCH2_NAIVE_SEMAPHORE_FUTEX
+
+bool
+semaphore::spin_acquire(int spins)
+{
+    for (int i = 0; i < spins; ++i) {
+        if (try_acquire()) {
+            return true;
+        }
+
+        // note discussions linked at
+        // https://en.cppreference.com/w/cpp/atomic/atomic_flag most notably
+        // https://www.realworldtech.com/forum/?threadid=189711&curpostid=189723
+        // which comes to the conclusion that doing sched_yield may be far from
+        // ideal on SMP systems and actually be worse than suspending the thread
+        // on a mutex especially considering this involves a syscall.
+        //
+        // So instead try to follow
+        // https://www.realworldtech.com/forum/?threadid=189711&curpostid=189755
+        // which basically suggests to do a plain read + relax operation instead
+        // to avoid stumping on cache lines while just waiting on the counter to
+        // be increased.
+        while (0 == available() && i < spins) {
+            thread_utils::cpu_relax();
+            ++i;
+        }
+    }
+    return false;
+}
+
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
@@ -28,11 +28,22 @@
 
 #include "naive_backend_internal.h"
 
+// block using futexes directly whenever available
+#if (defined XDISPATCH2_HAVE_LINUX_FUTEX_H)
+    #define XDISPATCH2_NAIVE_SEMAPHORE_FUTEX 1
+#endif
+
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
 /**
     @brief An efficient implementation of a counting semaphore
+
+    When futexes are available the count and the number of blocked
+    waiters are packed into a single word so that releasing the
+    semaphore takes a single atomic operation and a system call only
+    if there is waiters. Elsewise a mutex and a condition variable are
+    used to block waiters.
  */
 class semaphore
 {
@@ -85,10 +96,21 @@ public:
     void release(int count = 1);
 
 private:
+    // the count currently available
+    int available() const;
+
+#if (defined XDISPATCH2_NAIVE_SEMAPHORE_FUTEX)
+    // the half of m_state holding the count which is used as futex
+    uint32_t* futex_word();
+
+    // holds the count in the lower and the waiters in the upper half
+    std::atomic<uint64_t> m_state;
+#else
     std::atomic<int> m_count;
     std::atomic<int> m_waiters;
     std::mutex m_CS;
     std::condition_variable m_cond;
+#endif
 };
 
 } // namespace naive
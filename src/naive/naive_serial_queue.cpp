@@ -25,6 +25,8 @@
 #include "naive_operation_queue.h"
 #include "naive_threadpool.h"
 
+#include "../trace_utils.h"
+
 #include <thread>
 #include <mutex>
 #include <vector>
@@ -43,6 +45,7 @@ public:
                       backend_type backend)
       : iqueue_impl()
       , m_backend(backend)
+      , m_thread_bound(threadpool->thread_bound())
       , m_queue(std::make_shared<operation_queue>(threadpool, label, priority))
     {
         XDISPATCH_ASSERT(threadpool);
@@ -53,17 +56,41 @@ public:
 
     void async(const operation_ptr& op) final { m_queue->async(op); }
 
+    void async_unique(unique_operation&& op) final
+    {
+        m_queue->async(std::move(op));
+    }
+
+    void async_bulk(std::vector<unique_operation>&& ops) final
+    {
+        m_queue->async(std::move(ops));
+    }
+
     void apply(size_t times, const iteration_operation_ptr& op) final
     {
-        const auto completed = std::make_shared<consumable>(times);
-        for (size_t i = 0; i < times; ++i) {
-            async(std::make_shared<apply_operation>(i, op, completed));
+        // iterations execute one after another on a serial queue so a
+        // single job covers all of them. It is executed on the calling
+        // thread whenever possible which includes applies from within
+        // a job of this very queue. Queues bound to a thread such as the
+        // main queue must not run their jobs on any other thread though
+        unique_operation iterations([op, times] {
+            for (size_t i = 0; i < times; ++i) {
+                execute_operation_on_this_thread(*op, i);
+            }
+        });
+        if ((!m_thread_bound || m_queue->is_current()) &&
+            m_queue->try_execute(iterations)) {
+            return;
         }
-        completed->wait_for_consumed();
 
-        // FIXME(zwicker): This is blocking and will not work if invoked from
-        // within
-        //                 an operation active on this very same queue
+        // the queue is busy, wait for it to get to the iterations
+        const auto completed = std::make_shared<consumable>(1);
+        m_queue->async(unique_operation(
+          [iterations = std::move(iterations), completed]() mutable {
+              execute_operation_on_this_thread(iterations);
+              completed->consume_resource();
+          }));
+        completed->wait_for_consumed();
     }
 
     void after(std::chrono::milliseconds delay, const operation_ptr& op) final
@@ -75,8 +102,11 @@ public:
 
     backend_type backend() final { return m_backend; }
 
+    const operation_queue_ptr& operations() const { return m_queue; }
+
 private:
     const backend_type m_backend;
+    const bool m_thread_bound;
     operation_queue_ptr m_queue;
 };
 
@@ -100,6 +130,45 @@ create_serial_queue(const std::string& label,
     return create_serial_queue(label, thread, priority, backend_type::naive);
 }
 
+static operation_queue_ptr
+operation_queue_for(const queue& q)
+{
+    const auto impl =
+      std::dynamic_pointer_cast<serial_queue_impl>(q.implementation());
+    if (impl) {
+        return impl->operations();
+    }
+    XDISPATCH_WARNING() << "Not a serial queue of the naive backend: "
+                        << q.label();
+    return nullptr;
+}
+
+void
+drain_budget(const queue& q, const serial_queue_drain_budget& budget)
+{
+    if (const auto operations = operation_queue_for(q)) {
+        operations->budget(budget);
+    }
+}
+
+serial_queue_drain_budget
+drain_budget(const queue& q)
+{
+    if (const auto operations = operation_queue_for(q)) {
+        return operations->budget();
+    }
+    return serial_queue_drain_budget();
+}
+
+serial_queue_statistics
+statistics(const queue& q)
+{
+    if (const auto operations = operation_queue_for(q)) {
+        return operations->statistics();
+    }
+    return serial_queue_statistics();
+}
+
 iqueue_impl_ptr
 backend::create_serial_queue(const std::string& label,
                              queue_priority priority,
@@ -25,9 +25,12 @@
 
 #include "naive_threadpool.h"
 #include "naive_inverse_lockguard.h"
+#include "naive_reactor.h"
 #include "../trace_utils.h"
 
-#if (defined XDISPATCH2_HAVE_WINSOCK2)
+#if (defined XDISPATCH2_HAVE_EPOLL)
+    // readiness is reported by the reactor
+#elif (defined XDISPATCH2_HAVE_WINSOCK2)
     #include <winsock2.h>
 #elif (defined XDISPATCH2_HAVE_SOCKETPAIR)
     #include <sys/select.h>
@@ -40,6 +43,191 @@
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
 
+#if (defined XDISPATCH2_HAVE_EPOLL)
+
+class socket_notifier_impl
+  : public isocket_notifier_impl
+  , public reactor::watcher
+  , public std::enable_shared_from_this<socket_notifier_impl>
+{
+public:
+    socket_notifier_impl(const iqueue_impl_ptr& queue,
+                         socket_t socket,
+                         notifier_type type,
+                         notifier_trigger trigger,
+                         backend_type backend)
+      : isocket_notifier_impl()
+      , m_backend(backend)
+      , m_socket(socket)
+      , m_type(type)
+      , m_trigger(trigger)
+      , m_queue(queue)
+      , m_handler()
+      , m_resume_counter(0)
+      , m_registered(false)
+      , m_in_flight(false)
+      , m_pending(false)
+      , m_disarmed(false)
+    {}
+
+    ~socket_notifier_impl() override
+    {
+        if (m_registered) {
+            reactor::instance().remove(m_socket, m_type, this);
+        }
+    }
+
+    void handler(const socket_notifier_operation_ptr& op) final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_handler = op;
+    }
+
+    void target_queue(const iqueue_impl_ptr& q) final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_queue = q;
+    }
+
+    void resume() final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        if (m_resume_counter < 0) {
+            // cancelled so do not proceed
+            return;
+        }
+        if (1 != ++m_resume_counter) {
+            // only proceed when we become runnable
+            return;
+        }
+
+        auto& r = reactor::instance();
+        if (!m_registered) {
+            r.add(m_socket, m_type, m_trigger, shared_from_this());
+            m_registered = true;
+        }
+        // a handler still executing will arm the notifier once done
+        if (!m_in_flight) {
+            r.arm(m_socket, m_type);
+            m_disarmed = false;
+        }
+    }
+
+    void suspend() final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        if (m_resume_counter > 0) {
+            --m_resume_counter;
+            if (0 == m_resume_counter && m_registered) {
+                reactor::instance().disarm(m_socket, m_type);
+                m_disarmed = true;
+            }
+        }
+    }
+
+    void cancel() final
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            m_resume_counter = -1;
+            if (m_registered) {
+                reactor::instance().remove(m_socket, m_type, this);
+                m_registered = false;
+            }
+        }
+        m_handler_cancelable.disable();
+    }
+
+    socket_t socket() const final { return m_socket; }
+
+    notifier_type type() const final { return m_type; }
+
+    backend_type backend() final { return m_backend; }
+
+    void ready(notifier_type /* type */) final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        if (m_resume_counter <= 0) {
+            // suspended or cancelled meanwhile
+            return;
+        }
+        if (m_in_flight) {
+            // the handler is still executing, run it once more
+            // as soon as it completed to not miss this edge
+            m_pending = true;
+            return;
+        }
+        dispatch();
+    }
+
+private:
+    // needs to be called with m_CS held
+    void dispatch()
+    {
+        if (!m_handler || !m_queue) {
+            return;
+        }
+
+        XDISPATCH_TRACE() << "socket_notifier: Socket " << m_socket
+                          << " is ready";
+
+        m_in_flight = true;
+        const auto this_ptr = shared_from_this();
+        const auto handler = m_handler;
+        m_queue->async_unique(unique_operation([this_ptr, handler] {
+            {
+                cancelable_scope scope(this_ptr->m_handler_cancelable);
+                if (scope) {
+                    execute_operation_on_this_thread(
+                      *handler, this_ptr->m_socket, this_ptr->m_type);
+                }
+            }
+            this_ptr->completed();
+        }));
+    }
+
+    void completed()
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_in_flight = false;
+        if (m_resume_counter <= 0) {
+            // will be armed again when resuming
+            m_pending = false;
+            return;
+        }
+        if (m_pending) {
+            m_pending = false;
+            dispatch();
+        } else if (notifier_trigger::LEVEL == m_trigger || m_disarmed) {
+            // fires right away in case the socket is still ready, this
+            // includes edge-triggered notifiers suspended and resumed
+            // again by the handler as resume() left arming to us
+            reactor::instance().arm(m_socket, m_type);
+            m_disarmed = false;
+        }
+    }
+
+    const backend_type m_backend;
+    std::mutex m_CS;
+    const socket_t m_socket;
+    const notifier_type m_type;
+    const notifier_trigger m_trigger;
+    iqueue_impl_ptr m_queue;
+    socket_notifier_operation_ptr m_handler;
+    int m_resume_counter;
+    bool m_registered;
+    // set while the handler is dispatched or executing
+    bool m_in_flight;
+    // set when the socket became ready while the handler was in flight
+    bool m_pending;
+    // set when suspending disarmed the watch, it needs to be armed again
+    // even for edge-triggered notifiers
+    bool m_disarmed;
+    cancelable m_handler_cancelable;
+};
+
+#else
+
 class socket_notifier_impl
   : public isocket_notifier_impl
   , public std::enable_shared_from_this<socket_notifier_impl>
@@ -225,14 +413,40 @@ private:
     cancelable m_handler_cancelable;
 };
 
+#endif // XDISPATCH2_HAVE_EPOLL
+
 isocket_notifier_impl_ptr
 backend::create_socket_notifier(const iqueue_impl_ptr& queue,
                                 socket_t socket,
                                 notifier_type type,
                                 backend_type backend)
 {
+#if (defined XDISPATCH2_HAVE_EPOLL)
+    return std::make_shared<socket_notifier_impl>(
+      queue, socket, type, notifier_trigger::LEVEL, backend);
+#else
     return std::make_shared<socket_notifier_impl>(
       queue, global_threadpool(), socket, type, backend);
+#endif
+}
+
+socket_notifier
+create_socket_notifier(socket_t socket,
+                       notifier_type type,
+                       notifier_trigger trigger,
+                       const queue& target)
+{
+    const auto queue = target.implementation();
+#if (defined XDISPATCH2_HAVE_EPOLL)
+    const auto impl = std::make_shared<socket_notifier_impl>(
+      queue, socket, type, trigger, backend_type::naive);
+#else
+    // only level-triggered notifications are available
+    (void)trigger;
+    const auto impl = backend_for_type(backend_type::naive)
+                        .create_socket_notifier(queue, socket, type);
+#endif
+    return socket_notifier(impl, target);
 }
 
 } // namespace naive
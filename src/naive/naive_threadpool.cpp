@@ -24,6 +24,14 @@
 
 #include "naive_threadpool.h"
 #include "naive_operation_queue_manager.h"
+#include "naive_parking_slot.h"
+#include "naive_workstealing_deque.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
@@ -43,23 +51,34 @@ ithreadpool::current()
     return s_current_pool;
 }
 
-void
-ithreadpool::run_with_threadpool(operation& op, ithreadpool* pool)
+namespace {
+
+struct scoped_setter
 {
-    struct scoped_setter
+    scoped_setter(ithreadpool* pool)
+      : m_previous(s_current_pool)
     {
-        scoped_setter(ithreadpool* pool)
-          : m_previous(s_current_pool)
-        {
-            s_current_pool = pool;
-        }
+        s_current_pool = pool;
+    }
 
-        ~scoped_setter() { s_current_pool = m_previous; }
+    ~scoped_setter() { s_current_pool = m_previous; }
 
-    private:
-        ithreadpool* m_previous;
-    };
+private:
+    ithreadpool* m_previous;
+};
+
+} // namespace
+
+void
+ithreadpool::run_with_threadpool(operation& op, ithreadpool* pool)
+{
+    scoped_setter pool_scope(pool);
+    execute_operation_on_this_thread(op);
+}
 
+void
+ithreadpool::run_with_threadpool(unique_operation& op, ithreadpool* pool)
+{
     scoped_setter pool_scope(pool);
     execute_operation_on_this_thread(op);
 }
@@ -71,10 +90,85 @@ char const* const s_bucket_labels[threadpool::bucket_count] = {
     k_label_global_BACKGROUND
 };
 
-class threadpool::data
+using clock = std::chrono::steady_clock;
+
+/**
+    @brief An operation queued to one of the buckets or the local deque
+           of a worker
+
+    The time of queueing is only recorded for a sample of all operations
+    and will be left empty otherwise.
+ */
+struct queued_operation
+{
+    queued_operation() = default;
+
+    queued_operation(unique_operation&& op,
+                     int bucket,
+                     const clock::time_point& enqueued)
+      : m_op(std::move(op))
+      , m_bucket(bucket)
+      , m_enqueued(enqueued)
+    {}
+
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    unique_operation m_op;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    int m_bucket = -1;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    clock::time_point m_enqueued;
+};
+
+using stealable_deque = workstealing_deque<queued_operation>;
+using stealable_deque_ptr = std::shared_ptr<stealable_deque>;
+using stealable_deque_list = std::vector<stealable_deque_ptr>;
+
+/**
+    @brief The place an idle worker parks in until woken for new work
+
+    Slots link to each other while idle so that a worker which stops
+    idling by itself can be removed without searching for its slot.
+ */
+struct idle_slot
+{
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    parking_slot m_slot;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    clock::time_point m_woken;
+    // the worker which went idle before this one
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    idle_slot* m_below = nullptr;
+    // the worker which went idle after this one
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    idle_slot* m_above = nullptr;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    bool m_listed = false;
+};
+
+// the pool the current thread is a worker of and the deque it owns
+static thread_local threadpool* s_local_pool = nullptr;
+static thread_local stealable_deque* s_local_deque = nullptr;
+
+/**
+    @return the thread spawning new workers for all pools
+
+    Creating a thread takes a considerable amount of time which is kept
+    off the threads queueing operations this way.
+ */
+static thread&
+spawner()
+{
+    // remark: intentionally leak this object the same way as the
+    // operation_queue_manager so that it outlives all pools
+    static auto* s_spawner =
+      new thread("de.emzeat.xdispatch2.spawner", queue_priority::DEFAULT);
+    return *s_spawner;
+}
+
+class threadpool::data : public std::enable_shared_from_this<data>
 {
 public:
-    data(threadpool* owner)
+    data(threadpool* owner, const threadpool_config& config)
       : m_pool(owner)
       , m_operations_counter(0)
       , m_max_threads(0)
@@ -82,10 +176,392 @@ public:
       , m_idle_threads(0)
       , m_operations()
       , m_cancelled(false)
+      , m_work_stealing(config.work_stealing)
+      , m_min_threads(config.min_threads)
+      , m_affinity(config.affinity)
+      , m_weights()
+      , m_aging(0)
+      , m_spins(0)
+      , m_adaptive(false)
+      , m_yields(0)
+      , m_park_timeout(0)
+      , m_min_warm_threads(0)
+      , m_spawn_requests(0)
+      , m_last_spawn(0)
+      , m_last_retire(0)
+      , m_waits()
+      , m_wakes()
+      , m_idle_CS()
+      , m_idle_top(nullptr)
+      , m_deques_CS()
+      , m_deques(std::make_shared<const stealable_deque_list>())
+      , m_unused_deques()
+      , m_siblings(std::make_shared<const sibling_list>())
+      , m_has_siblings(false)
+      , m_producers_CS()
+      , m_producers()
     {
         XDISPATCH_ASSERT(m_max_threads.is_lock_free());
         XDISPATCH_ASSERT(m_active_threads.is_lock_free());
         XDISPATCH_ASSERT(m_idle_threads.is_lock_free());
+
+        static const bucket_weights skDefaultWeights = { 8, 4, 2, 1 };
+        for (int bucket = 0; bucket < bucket_count; ++bucket) {
+            m_weights[bucket] = skDefaultWeights[bucket];
+        }
+        m_aging = std::chrono::milliseconds(50).count();
+    }
+
+    /**
+        @brief Hands out a deque to be owned by a worker
+
+        Deques of workers which ended are reused as they may still
+        hold operations and are known to all thieves already.
+     */
+    stealable_deque_ptr acquire_deque()
+    {
+        std::lock_guard<std::mutex> lock(m_deques_CS);
+        if (!m_unused_deques.empty()) {
+            auto deque = m_unused_deques.back();
+            m_unused_deques.pop_back();
+            return deque;
+        }
+
+        auto deque = std::make_shared<stealable_deque>();
+        auto deques = std::make_shared<stealable_deque_list>(*m_deques);
+        deques->push_back(deque);
+        std::atomic_store(&m_deques,
+                          std::shared_ptr<const stealable_deque_list>(deques));
+        return deque;
+    }
+
+    /**
+        @brief Returns a deque previously obtained via acquire_deque()
+     */
+    void release_deque(const stealable_deque_ptr& deque)
+    {
+        std::lock_guard<std::mutex> lock(m_deques_CS);
+        m_unused_deques.push_back(deque);
+    }
+
+    /**
+        @brief Records the time an operation waited in the given bucket
+     */
+    void record_wait(int bucket, std::chrono::nanoseconds waited)
+    {
+        record(m_waits[bucket], waited);
+    }
+
+    /**
+        @brief Records the time a worker took to run after being woken
+     */
+    void record_wake(std::chrono::nanoseconds latency)
+    {
+        record(m_wakes, latency);
+    }
+
+    /**
+        @return the statistics collected via record_wait()
+     */
+    bucket_statistics statistics() const
+    {
+        bucket_statistics statistics;
+        for (int bucket = 0; bucket < bucket_count; ++bucket) {
+            const auto& stats = m_waits[bucket];
+            auto& result = statistics[bucket];
+            result.samples = stats.m_samples.load(std::memory_order_relaxed);
+            if (result.samples > 0) {
+                result.average_wait = std::chrono::nanoseconds(
+                  stats.m_total.load(std::memory_order_relaxed) /
+                  result.samples);
+                result.max_wait = std::chrono::nanoseconds(
+                  stats.m_max.load(std::memory_order_relaxed));
+            }
+        }
+        return statistics;
+    }
+
+    /**
+        @return the statistics collected via record_wake()
+     */
+    threadpool_wake_statistics wake_statistics() const
+    {
+        threadpool_wake_statistics result;
+        result.samples = m_wakes.m_samples.load(std::memory_order_relaxed);
+        if (result.samples > 0) {
+            result.average_latency = std::chrono::nanoseconds(
+              m_wakes.m_total.load(std::memory_order_relaxed) /
+              result.samples);
+            result.max_latency = std::chrono::nanoseconds(
+              m_wakes.m_max.load(std::memory_order_relaxed));
+        }
+        return result;
+    }
+
+    /**
+        @brief Lowers the number of active threads unless this would
+               make it drop below the minimum number of warm threads
+
+        @return true if the calling thread is good to end
+     */
+    bool retire_thread()
+    {
+        auto active = m_active_threads.load(std::memory_order_relaxed);
+        do {
+            if (!m_cancelled &&
+                active <= static_cast<int>(m_min_warm_threads.load(
+                            std::memory_order_relaxed))) {
+                return false;
+            }
+        } while (!m_active_threads.compare_exchange_weak(
+          active, active - 1, std::memory_order_acq_rel));
+        return true;
+    }
+
+    /**
+        @brief Decides if a worker idling for the whole park timeout
+               may retire
+
+        Workers are kept for a multiple of the park timeout after the
+        pool had to spawn a new worker as the load is likely to come
+        back. Afterwards workers retire one at a time. Both avoid
+        churning threads when the load changes at about the pace of
+        the park timeout.
+     */
+    bool may_retire()
+    {
+        static constexpr clock::rep skSpawnHysteresis = 4;
+        static constexpr clock::rep skRetireSpread = 8;
+
+        const auto now = clock::now().time_since_epoch().count();
+        const auto timeout =
+          std::chrono::duration_cast<clock::duration>(
+            std::chrono::milliseconds(
+              m_park_timeout.load(std::memory_order_relaxed)))
+            .count();
+
+        // a value of zero denotes that there was no such event yet
+        const auto last_spawn = m_last_spawn.load(std::memory_order_relaxed);
+        if (0 != last_spawn && now - last_spawn < skSpawnHysteresis * timeout) {
+            return false;
+        }
+        auto last_retire = m_last_retire.load(std::memory_order_relaxed);
+        if (0 != last_retire && now - last_retire < timeout / skRetireSpread) {
+            return false;
+        }
+        return m_last_retire.compare_exchange_strong(
+          last_retire, now, std::memory_order_relaxed);
+    }
+
+    /**
+        @brief Counts another worker as active unless the maximum
+               number of workers is active already
+
+        @return false if no more workers may be spawned
+     */
+    bool reserve_worker()
+    {
+        auto active = m_active_threads.load(std::memory_order_relaxed);
+        do {
+            if (active >= m_max_threads.load(std::memory_order_relaxed)) {
+                return false;
+            }
+        } while (!m_active_threads.compare_exchange_weak(
+          active, active + 1, std::memory_order_acq_rel));
+        return true;
+    }
+
+    /**
+        @brief Has a new worker spawned by the spawner thread
+
+        The worker is counted as active right away so that no more
+        workers get requested than allowed.
+
+        @return false if the maximum number of workers is active already
+     */
+    bool request_worker()
+    {
+        if (m_cancelled || !reserve_worker()) {
+            return false;
+        }
+        m_last_spawn.store(clock::now().time_since_epoch().count(),
+                           std::memory_order_relaxed);
+
+        // requests made while the spawner is busy are picked up by it
+        // without queueing another operation to the spawner
+        if (0 == m_spawn_requests.fetch_add(1, std::memory_order_acq_rel)) {
+            auto self = shared_from_this();
+            spawner().execute(
+              make_operation([self] { self->spawn_requested(); }));
+        }
+        return true;
+    }
+
+    /**
+        @brief Spawns a worker which was counted as active already
+     */
+    void spawn_worker();
+
+    /**
+        @brief Adds an idle worker on top of the idle workers
+
+        @return the number of idle workers including the one added
+     */
+    int push_idle(idle_slot* slot)
+    {
+        std::lock_guard<std::mutex> lock(m_idle_CS);
+        slot->m_below = m_idle_top;
+        slot->m_above = nullptr;
+        slot->m_listed = true;
+        if (m_idle_top) {
+            m_idle_top->m_above = slot;
+        }
+        m_idle_top = slot;
+        return m_idle_threads.fetch_add(1, std::memory_order_seq_cst) + 1;
+    }
+
+    /**
+        @brief Removes an idle worker which stopped idling by itself
+
+        @return false if the worker was woken and removed already
+     */
+    bool remove_idle(idle_slot* slot)
+    {
+        std::lock_guard<std::mutex> lock(m_idle_CS);
+        if (!slot->m_listed) {
+            return false;
+        }
+        unlink_idle(slot);
+        m_idle_threads.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+        @brief Wakes the worker which went idle last
+
+        @return false if there was no idle worker
+     */
+    bool wake_idle()
+    {
+        // pairs with the fence in worker::idle() so that either the
+        // worker sees the operation counted or we see the worker idle
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (0 == m_idle_threads.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        // the slot is woken holding the lock so that the worker cannot
+        // end and take the slot with it while we are still accessing it
+        std::lock_guard<std::mutex> lock(m_idle_CS);
+        auto* slot = m_idle_top;
+        if (nullptr == slot) {
+            return false;
+        }
+        unlink_idle(slot);
+        m_idle_threads.fetch_sub(1, std::memory_order_release);
+        slot->m_woken = clock::now();
+        slot->m_slot.unpark();
+        return true;
+    }
+
+    /**
+        @brief Wakes all idle workers
+     */
+    void wake_all_idle()
+    {
+        std::lock_guard<std::mutex> lock(m_idle_CS);
+        const auto now = clock::now();
+        int woken = 0;
+        while (auto* slot = m_idle_top) {
+            unlink_idle(slot);
+            slot->m_woken = now;
+            slot->m_slot.unpark();
+            ++woken;
+        }
+        m_idle_threads.fetch_sub(woken, std::memory_order_release);
+    }
+
+    // needs to be called with m_idle_CS held
+    void unlink_idle(idle_slot* slot)
+    {
+        if (slot->m_below) {
+            slot->m_below->m_above = slot->m_above;
+        }
+        if (slot->m_above) {
+            slot->m_above->m_below = slot->m_below;
+        } else {
+            m_idle_top = slot->m_below;
+        }
+        slot->m_below = nullptr;
+        slot->m_above = nullptr;
+        slot->m_listed = false;
+    }
+
+    /**
+        @return a snapshot of all deques which may be stolen from
+     */
+    std::shared_ptr<const stealable_deque_list> deques() const
+    {
+        return std::atomic_load(&m_deques);
+    }
+
+    /**
+        @brief The producer tokens of a single thread, one per bucket
+
+        Tokens are created lazily on first use of a bucket.
+     */
+    class producer_tokens
+    {
+    public:
+        producer_token& token(data& pool, int bucket)
+        {
+            auto& token = m_tokens[bucket];
+            if (!token) {
+                token.reset(new producer_token(pool.m_operations[bucket]));
+            }
+            return *token;
+        }
+
+    private:
+        std::array<std::unique_ptr<producer_token>, bucket_count> m_tokens;
+    };
+
+    /**
+        @return the producer tokens of the calling thread
+     */
+    producer_tokens& producer()
+    {
+        static thread_local producer_cache s_producers;
+        return s_producers.tokens(*this);
+    }
+
+    using sibling_list = std::vector<std::weak_ptr<threadpool>>;
+
+    /**
+        @brief Changes the pools idle workers may steal from
+     */
+    void siblings(const std::shared_ptr<const sibling_list>& siblings)
+    {
+        std::atomic_store(&m_siblings, siblings);
+        m_has_siblings.store(!siblings->empty(), std::memory_order_release);
+    }
+
+    /**
+        @return true if there is pools idle workers may steal from
+
+        Allows to skip taking a snapshot for pools without siblings.
+     */
+    bool has_siblings() const
+    {
+        return m_has_siblings.load(std::memory_order_acquire);
+    }
+
+    /**
+        @return a snapshot of the pools idle workers may steal from
+     */
+    std::shared_ptr<const sibling_list> siblings() const
+    {
+        return std::atomic_load(&m_siblings);
     }
 
     // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
@@ -99,16 +575,169 @@ public:
     // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
     std::atomic<int> m_idle_threads;
     // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
-    std::array<concurrentqueue<operation_ptr>, bucket_count> m_operations;
+    std::array<concurrentqueue<queued_operation>, bucket_count> m_operations;
     // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
     std::atomic<bool> m_cancelled;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    const bool m_work_stealing;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    const unsigned m_min_threads;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    const std::vector<int> m_affinity;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::array<std::atomic<unsigned>, bucket_count> m_weights;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<std::chrono::milliseconds::rep> m_aging;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<unsigned> m_spins;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<bool> m_adaptive;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<unsigned> m_yields;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<std::chrono::milliseconds::rep> m_park_timeout;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<unsigned> m_min_warm_threads;
+
+private:
+    /**
+        @brief Spawns all requested workers, run by the spawner thread
+     */
+    void spawn_requested();
+
+    struct wait_statistics
+    {
+        std::atomic<uint64_t> m_samples{ 0 };
+        std::atomic<uint64_t> m_total{ 0 };
+        std::atomic<uint64_t> m_max{ 0 };
+    };
+
+    static void record(wait_statistics& stats, std::chrono::nanoseconds value)
+    {
+        const auto nsec = static_cast<uint64_t>(value.count());
+        stats.m_samples.fetch_add(1, std::memory_order_relaxed);
+        stats.m_total.fetch_add(nsec, std::memory_order_relaxed);
+        auto max = stats.m_max.load(std::memory_order_relaxed);
+        while (nsec > max && !stats.m_max.compare_exchange_weak(
+                               max, nsec, std::memory_order_relaxed)) {
+        }
+    }
+
+    /**
+        @brief The tokens the calling thread uses with each pool
+
+        The tokens are owned by their pool so that they can be destroyed
+        before the queues they were created for. Threads ending return
+        their tokens to pools still around.
+     */
+    class producer_cache
+    {
+    public:
+        producer_cache() = default;
+        producer_cache(const producer_cache&) = delete;
+        ~producer_cache();
+
+        producer_tokens& tokens(data& pool);
+
+    private:
+        struct entry
+        {
+            const data* m_pool;
+            std::weak_ptr<data> m_owner;
+            producer_tokens* m_tokens;
+        };
+
+        std::vector<entry> m_entries;
+    };
+
+    producer_tokens* acquire_producer()
+    {
+        std::lock_guard<std::mutex> lock(m_producers_CS);
+        m_producers.emplace_back(new producer_tokens);
+        return m_producers.back().get();
+    }
+
+    void release_producer(producer_tokens* tokens)
+    {
+        std::lock_guard<std::mutex> lock(m_producers_CS);
+        m_producers.erase(
+          std::find_if(m_producers.begin(),
+                       m_producers.end(),
+                       [tokens](const std::unique_ptr<producer_tokens>& p) {
+                           return p.get() == tokens;
+                       }));
+    }
+
+    std::atomic<int> m_spawn_requests;
+    std::atomic<clock::rep> m_last_spawn;
+    std::atomic<clock::rep> m_last_retire;
+    std::array<wait_statistics, bucket_count> m_waits;
+    wait_statistics m_wakes;
+    // the idle workers, the one which went idle last is on top
+    std::mutex m_idle_CS;
+    idle_slot* m_idle_top;
+    std::mutex m_deques_CS;
+    std::shared_ptr<const stealable_deque_list> m_deques;
+    stealable_deque_list m_unused_deques;
+    std::shared_ptr<const sibling_list> m_siblings;
+    std::atomic<bool> m_has_siblings;
+    // declared after the queues so that the tokens go first
+    std::mutex m_producers_CS;
+    std::vector<std::unique_ptr<producer_tokens>> m_producers;
 };
 
+threadpool::data::producer_cache::~producer_cache()
+{
+    for (const auto& entry : m_entries) {
+        // tokens of pools which ended already are gone with them
+        if (const auto pool = entry.m_owner.lock()) {
+            pool->release_producer(entry.m_tokens);
+        }
+    }
+}
+
+threadpool::data::producer_tokens&
+threadpool::data::producer_cache::tokens(data& pool)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->m_pool != &pool) {
+            continue;
+        }
+        // another pool might have been created in place of one ended
+        if (!it->m_owner.expired()) {
+            return *it->m_tokens;
+        }
+        m_entries.erase(it);
+        break;
+    }
+
+    // forget about pools which ended meanwhile
+    m_entries.erase(std::remove_if(m_entries.begin(),
+                                   m_entries.end(),
+                                   [](const entry& e) {
+                                       return e.m_owner.expired();
+                                   }),
+                    m_entries.end());
+    m_entries.push_back(
+      entry{ &pool, pool.shared_from_this(), pool.acquire_producer() });
+    return *m_entries.back().m_tokens;
+}
+
 class threadpool::worker
 {
 public:
     explicit worker(const threadpool::data_ptr& data)
       : m_data(data)
+      , m_deque(data->m_work_stealing ? data->acquire_deque() : nullptr)
+      , m_seed(0)
+      , m_local_pops(0)
+      , m_credits()
+      , m_aged(0)
+      , m_round_start(clock::now())
+      , m_last_served()
+      , m_spin_budget(data->m_spins.load(std::memory_order_relaxed))
+      , m_idle()
+      , m_consumers(consumer_tokens(*data))
       , m_thread(&worker::run, this)
     {}
 
@@ -116,67 +745,63 @@ public:
     {
         XDISPATCH_ASSERT(m_thread.joinable());
         m_thread.join();
+        if (m_deque) {
+            m_data->release_deque(m_deque);
+        }
     }
 
     std::thread::id get_id() const { return m_thread.get_id(); }
 
     void run()
     {
-        static constexpr int skMaxSpinsBeforeSleep = 1000;
-        static constexpr auto skMaxSleepBeforeThreadExit =
-          std::chrono::seconds(30);
+        if (!m_data->m_affinity.empty()) {
+            thread_utils::set_current_thread_affinity(m_data->m_affinity);
+        }
+        s_local_pool = m_data->m_pool;
+        s_local_deque = m_deque.get();
+        m_seed = static_cast<unsigned>(
+          std::hash<std::thread::id>()(std::this_thread::get_id()));
+        m_last_served.fill(m_round_start);
 
         int last_label = -1;
         while (!m_data->m_cancelled) {
-            operation_ptr op;
+            unique_operation op;
             int label = -1;
             {
-                // if no op we are idling and need to block on our op counter
+                // operations queued to the deque of a worker are not counted
+                // by the semaphore, they are picked up by the owning worker
+                // first and stolen by other workers before these go idle.
+                // If no op we are idling and need to block on our op counter
                 // NOLINTNEXTLINE(bugprone-branch-clone)
-                if (m_data->m_operations_counter.try_acquire()) {
+                if (local_first() && pop_local(op, label)) {
+                    // picked an operation of our own
+                } else if (m_data->m_operations_counter.try_acquire()) {
                     // all good go pick the operation
-                } else if (m_data->m_operations_counter.spin_acquire(
-                             skMaxSpinsBeforeSleep)) {
+                } else if (pop_local(op, label) || steal(op, label)) {
+                    // picked an operation queued locally
+                } else if (spin()) {
                     // all good go pick the operation
+                } else if (steal_sibling(op, label)) {
+                    // picked an operation of another pool
                 } else {
                     if (trace_utils::is_debug_enabled()) {
                         thread_utils::set_current_thread_name("");
                         last_label = -1;
                     }
 
-                    // FIXME(zwicker): We mark a thread as idle pretty late
-                    // as it is technically idle during try_acquire() and
-                    // spin_acquire() as well but this is kept in here for now
-                    // to keep the fast path as simple as possible.
-                    const auto idle_threads = m_data->m_idle_threads.fetch_add(
-                                                1, std::memory_order_acq_rel) +
-                                              1;
-                    const auto active_threads =
-                      m_data->m_active_threads.load(std::memory_order_consume);
-                    XDISPATCH_TP_TRACE(
-                      m_data->m_pool, idle_threads, active_threads)
-                      << "Thread " << std::this_thread::get_id() << " idling";
-
                     // wait up to a timeout for the counter to acquire, if the
                     // timeout is reached we end this thread again to free
                     // resources in the system
-                    if (m_data->m_operations_counter.wait_acquire(
-                          skMaxSleepBeforeThreadExit)) {
+                    if (idle(op, label)) {
                         // all good go pick the operation
-                        m_data->m_idle_threads.fetch_sub(
-                          1, std::memory_order_release);
                     } else {
                         // end this thread it seems there is no work remaining
-                        m_data->m_idle_threads.fetch_sub(
-                          1, std::memory_order_release);
-                        m_data->m_active_threads.fetch_sub(
-                          1, std::memory_order_release);
 
                         // Opportunistic recovery:
                         // There is a chance that while we made the decision to
                         // end (as no work seems remaining) such work was
-                        // actually added while we updated the two counters
-                        // above. In that case we must not end, because the
+                        // actually added while we updated the counters when
+                        // retiring. In that case we must not end, because the
                         // entity adding work may have decided there is no need
                         // to trigger a new thread (as it still deemed us
                         // active). To recover we need to check a last time for
@@ -194,25 +819,13 @@ public:
                     }
                 }
 
-                // search for the next operation starting with the highest
-                // priority
-                // Note: there has to be such operation as we acquired the
-                //       semaphore above so if popping fails spontaneously
-                //       we are good to repeat
-                // FIXME(zwicker): This is unfair; if enough high prio ops get
-                //                 queued we will never drain the lower prio ops
-                for (label = 0; !m_data->m_cancelled; ++label) {
-                    if (bucket_count == label) {
-                        label = 0;
-                    }
-
-                    auto& ops_prio = m_data->m_operations[label];
-                    ops_prio.try_dequeue(op);
-                    if (op) {
-                        break;
-                    }
+                // search for the next operation
+                // Note: there has to be such operation in one of the buckets
+                //       as we acquired the semaphore above so if popping
+                //       fails spontaneously we are good to repeat.
+                while (!op && !m_data->m_cancelled && !pop_global(op, label)) {
                 }
-                XDISPATCH_ASSERT(op);
+                XDISPATCH_ASSERT(op || m_data->m_cancelled);
             }
 
             if (op) {
@@ -222,11 +835,14 @@ public:
                     last_label = label;
                 }
 
-                run_with_threadpool(*op, m_data->m_pool);
+                run_with_threadpool(op, m_data->m_pool);
                 op.reset();
             }
         }
 
+        s_local_pool = nullptr;
+        s_local_deque = nullptr;
+
         const auto remaining =
           m_data->m_active_threads.load(std::memory_order_consume);
         const auto idle =
@@ -237,50 +853,490 @@ public:
     }
 
 private:
+    // the fraction of the configured spins an adaptive worker keeps up
+    static constexpr unsigned skMinFraction = 256;
+
+    /**
+        @return the time spinning may take at most to still be faster
+                than parking and being woken again
+     */
+    std::chrono::nanoseconds break_even() const
+    {
+        // the cost of parking assumed until wake latencies were measured,
+        // also bounding it as wakes get slower when the processors are
+        // busy which must not make us burn even more time spinning
+        static constexpr auto skMaxBreakEven = std::chrono::nanoseconds(
+          std::chrono::microseconds(20));
+
+        const auto wakes = m_data->wake_statistics();
+        return wakes.samples > 0
+                 ? std::min(wakes.average_latency, skMaxBreakEven)
+                 : skMaxBreakEven;
+    }
+
+    static std::vector<consumer_token> consumer_tokens(data& pool)
+    {
+        std::vector<consumer_token> tokens;
+        tokens.reserve(bucket_count);
+        for (auto& operations : pool.m_operations) {
+            tokens.emplace_back(operations);
+        }
+        return tokens;
+    }
+
+    /**
+        @brief Spins and yields as configured by the park policy until
+               an operation can be acquired
+
+        @return false if no operation became available meanwhile
+     */
+    bool spin()
+    {
+        const auto spins = m_data->m_spins.load(std::memory_order_relaxed);
+        const auto yields = m_data->m_yields.load(std::memory_order_relaxed);
+        const bool adaptive =
+          m_data->m_adaptive.load(std::memory_order_relaxed);
+
+        auto budget = spins;
+        if (adaptive) {
+            // never stop spinning entirely, we would not notice
+            // when spinning became worthwhile again otherwise
+            const auto floor = std::max(spins / skMinFraction, 1U);
+            budget = std::min(std::max(m_spin_budget, floor), spins);
+        }
+
+        bool hit = false;
+        if (!adaptive) {
+            hit = budget > 0 && m_data->m_operations_counter.spin_acquire(
+                                  static_cast<int>(budget));
+        } else {
+            // spinning only pays off while it takes less time than parking
+            // and being woken again would, so never spin for longer than
+            // that, grow the budget slowly when spinning was of use and
+            // halve it otherwise so that long gaps end up costing a few
+            // spins only
+            constexpr unsigned kSpinsPerCheck = 256;
+            const auto limit = clock::now() + break_even();
+            unsigned spun = 0;
+            while (!hit && spun < budget && clock::now() < limit) {
+                const auto chunk = std::min(budget - spun, kSpinsPerCheck);
+                hit = m_data->m_operations_counter.spin_acquire(
+                  static_cast<int>(chunk));
+                spun += chunk;
+            }
+            m_spin_budget =
+              hit ? budget + std::max(budget / 4, 1U) : budget / 2;
+        }
+        for (unsigned i = 0; !hit && i < yields; ++i) {
+            std::this_thread::yield();
+            hit = m_data->m_operations_counter.try_acquire();
+        }
+        return hit;
+    }
+
+    /**
+        @brief Parks this worker until an operation can be acquired
+
+        @param op Receives an operation stolen from another worker
+                  or from a sibling pool
+        @param label Receives the bucket of that operation
+
+        @return false if no operation became available within the park
+                timeout and the thread got retired
+     */
+    bool idle(unique_operation& op, int& label)
+    {
+        const auto timeout = std::chrono::milliseconds(
+          m_data->m_park_timeout.load(std::memory_order_relaxed));
+
+        // do not hold back memory of operations other threads allocated
+        // while we are parked, their owners would allocate again instead
+        flush_operation_deallocations();
+
+        // FIXME(zwicker): We mark a thread as idle pretty late
+        // as it is technically idle during try_acquire() and
+        // spin_acquire() as well but this is kept in here for now
+        // to keep the fast path as simple as possible.
+        for (;;) {
+            const auto idle_threads = m_data->push_idle(&m_idle);
+            const auto active_threads =
+              m_data->m_active_threads.load(std::memory_order_consume);
+            XDISPATCH_TP_TRACE(m_data->m_pool, idle_threads, active_threads)
+              << "Thread " << std::this_thread::get_id() << " idling";
+
+            // pairs with the fence in data::wake_idle(), operations counted
+            // or pushed to a deque before we became visible as idle have
+            // to be picked up here
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const bool acquired =
+              m_data->m_operations_counter.try_acquire() || steal(op, label);
+            if (acquired || m_data->m_cancelled) {
+                if (!m_data->remove_idle(&m_idle)) {
+                    // got woken meanwhile, consume the wakeup
+                    m_idle.m_slot.park(timeout);
+                }
+                return acquired || !m_data->retire_thread();
+            }
+
+            bool woken = m_idle.m_slot.park(timeout);
+            if (!woken && !m_data->remove_idle(&m_idle)) {
+                // got woken while timing out, consume the wakeup
+                woken = m_idle.m_slot.park(timeout);
+                XDISPATCH_ASSERT(woken);
+            }
+            if (!woken) {
+                if (m_data->may_retire() && m_data->retire_thread()) {
+                    return false;
+                }
+                // kept warm, go back to idling
+                continue;
+            }
+            m_data->record_wake(clock::now() - m_idle.m_woken);
+            if (m_data->m_cancelled) {
+                return !m_data->retire_thread();
+            }
+            if (m_data->m_operations_counter.try_acquire() ||
+                steal(op, label) || steal_sibling(op, label)) {
+                return true;
+            }
+            // the operation we were woken for was taken by another
+            // worker which was still busy, go back to idling
+        }
+    }
+
+    /**
+        @return false if the shared buckets are due to be checked before
+                taking any more work from the local deque
+     */
+    bool local_first()
+    {
+        // the shared buckets are checked once in a while even if there is
+        // local work pending so that they will not starve while workers
+        // are busy with forking more and more operations locally
+        static constexpr unsigned skLocalPopsBeforeGlobal = 61;
+
+        return (++m_local_pops % skLocalPopsBeforeGlobal) != 0;
+    }
+
+    bool pop_global(unique_operation& op, int& label)
+    {
+        // buckets not served for too long go first
+        for (label = 0; m_aged && label < bucket_count; ++label) {
+            const unsigned mask = 1U << label;
+            if (m_aged & mask) {
+                m_aged &= ~mask;
+                if (dequeue(label, op)) {
+                    return true;
+                }
+            }
+        }
+
+        // serve the buckets by priority for as long as they have credits
+        for (label = 0; label < bucket_count; ++label) {
+            if (m_credits[label] > 0) {
+                if (dequeue(label, op)) {
+                    --m_credits[label];
+                    return true;
+                }
+                // an empty bucket forfeits its remaining credits
+                m_credits[label] = 0;
+            }
+        }
+
+        // all buckets either used up their credits or are empty so begin a
+        // new round and serve the buckets having a weight first
+        start_round();
+        for (label = 0; label < bucket_count; ++label) {
+            if (m_credits[label] > 0 && dequeue(label, op)) {
+                --m_credits[label];
+                return true;
+            }
+        }
+
+        // buckets weighted zero are served only when all others are empty,
+        // we must not idle with work pending in such bucket either
+        for (label = 0; label < bucket_count; ++label) {
+            if (0 == m_credits[label] && dequeue(label, op)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void start_round()
+    {
+        const auto now = clock::now();
+        const auto aging = std::chrono::milliseconds(
+          m_data->m_aging.load(std::memory_order_relaxed));
+        for (int bucket = 0; bucket < bucket_count; ++bucket) {
+            m_credits[bucket] =
+              m_data->m_weights[bucket].load(std::memory_order_relaxed);
+            if (now - m_last_served[bucket] > aging) {
+                m_aged |= 1U << bucket;
+            }
+        }
+        m_round_start = now;
+    }
+
+    bool dequeue(int bucket, unique_operation& op)
+    {
+        // an empty bucket is as good as served, nobody is waiting
+        m_last_served[bucket] = m_round_start;
+
+        queued_operation item;
+        if (m_data->m_operations[bucket].try_dequeue(m_consumers[bucket],
+                                                     item)) {
+            record_wait(item);
+            op = std::move(item.m_op);
+            return true;
+        }
+        return false;
+    }
+
+    void record_wait(const queued_operation& item)
+    {
+        if (item.m_enqueued != clock::time_point()) {
+            m_data->record_wait(item.m_bucket, clock::now() - item.m_enqueued);
+        }
+    }
+
+    bool pop_local(unique_operation& op, int& label)
+    {
+        queued_operation item;
+        return m_deque && m_deque->pop(item) && take(item, op, label);
+    }
+
+    bool steal(unique_operation& op, int& label)
+    {
+        if (!m_data->m_work_stealing) {
+            return false;
+        }
+        const auto deques = m_data->deques();
+        const auto count = deques->size();
+        if (0 == count || (1 == count && m_deque)) {
+            return false;
+        }
+
+        // start at a random victim so that thieves spread out evenly
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 17;
+        m_seed ^= m_seed << 5;
+        const auto first = m_seed % count;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& victim = (*deques)[(first + i) % count];
+            if (victim != m_deque && steal_from(*victim, op, label)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+        @brief Takes an operation queued to one of the sibling pools
+
+        Only done by workers about to idle so that operations stay
+        with the pool they were queued to whenever it is busy itself.
+     */
+    bool steal_sibling(unique_operation& op, int& label)
+    {
+        if (!m_data->has_siblings()) {
+            return false;
+        }
+        for (const auto& sibling : *m_data->siblings()) {
+            const auto pool = sibling.lock();
+            if (!pool) {
+                continue;
+            }
+            const auto& other = pool->m_data;
+            for (const auto& victim : *other->deques()) {
+                if (steal_from(*victim, op, label)) {
+                    return true;
+                }
+            }
+            if (!other->m_operations_counter.try_acquire()) {
+                continue;
+            }
+
+            // there has to be an operation as we acquired the semaphore
+            while (!other->m_cancelled) {
+                queued_operation item;
+                for (label = 0; label < bucket_count; ++label) {
+                    if (other->m_operations[label].try_dequeue(item)) {
+                        op = std::move(item.m_op);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    bool steal_from(stealable_deque& victim, unique_operation& op, int& label)
+    {
+        queued_operation item;
+        return victim.steal(item) && take(item, op, label);
+    }
+
+    bool take(queued_operation& item, unique_operation& op, int& label)
+    {
+        record_wait(item);
+        op = std::move(item.m_op);
+        label = item.m_bucket;
+        return true;
+    }
+
     threadpool::data_ptr m_data;
+    stealable_deque_ptr m_deque;
+    unsigned m_seed;
+    unsigned m_local_pops;
+    std::array<unsigned, bucket_count> m_credits;
+    unsigned m_aged;
+    clock::time_point m_round_start;
+    std::array<clock::time_point, bucket_count> m_last_served;
+    unsigned m_spin_budget;
+    idle_slot m_idle;
+    std::vector<consumer_token> m_consumers;
     std::thread m_thread;
 };
 
-threadpool::threadpool()
+void
+threadpool::data::spawn_worker()
+{
+    auto thread = std::make_shared<worker>(shared_from_this());
+    operation_queue_manager::instance().attach(thread);
+
+    XDISPATCH_TP_TRACE(m_pool,
+                       m_active_threads.load(std::memory_order_consume),
+                       m_idle_threads.load(std::memory_order_consume))
+      << "Spawned thread " << thread->get_id()
+      << " (max=" << m_max_threads << ")";
+}
+
+void
+threadpool::data::spawn_requested()
+{
+    while (auto requests =
+             m_spawn_requests.exchange(0, std::memory_order_acq_rel)) {
+        for (; requests > 0; --requests) {
+            if (m_cancelled) {
+                // the pool ended meanwhile, hand back the reservation
+                m_active_threads.fetch_sub(1, std::memory_order_release);
+            } else {
+                spawn_worker();
+            }
+        }
+    }
+}
+
+static threadpool_config
+make_config(bool work_stealing, const threadpool_park_policy& policy)
+{
+    threadpool_config config;
+    config.work_stealing = work_stealing;
+    config.park_policy = policy;
+    return config;
+}
+
+threadpool::threadpool(bool work_stealing,
+                       const threadpool_park_policy& policy)
+  : threadpool(make_config(work_stealing, policy))
+{}
+
+threadpool::threadpool(const threadpool_config& config)
   : ithreadpool()
-  , m_data(std::make_shared<data>(this))
+  , m_data(std::make_shared<data>(this, config))
 {
     // we are overcommitting by default so that it becomes less likely
     // that operations get starved due to threads blocking on resources
     m_data->m_max_threads =
-      static_cast<int>(2 * thread_utils::system_thread_count());
+      config.max_threads > 0
+        ? static_cast<int>(config.max_threads)
+        : static_cast<int>(2 * thread_utils::system_thread_count());
     XDISPATCH_TRACE() << "threadpool with " << m_data->m_max_threads
-                      << " system threads";
+                      << " system threads"
+                      << (config.work_stealing ? " (work stealing)" : "");
+    park_policy(config.park_policy);
 }
 
 threadpool::~threadpool()
 {
     m_data->m_cancelled = true;
-    m_data->m_operations_counter.release(m_data->m_active_threads);
+    m_data->wake_all_idle();
 }
 
 void
 threadpool::execute(const operation_ptr& work, const queue_priority priority)
+{
+    execute_unique(unique_operation(work), priority);
+}
+
+/**
+    @return the bucket operations of the given priority are queued to
+ */
+static int
+bucket_for(const queue_priority priority)
 {
     int index = -1;
     switch (priority) {
         case queue_priority::USER_INTERACTIVE:
-            index = bucket_USER_INTERACTIVE;
+            index = threadpool::bucket_USER_INTERACTIVE;
             break;
         case queue_priority::USER_INITIATED:
-            index = bucket_USER_INITIATED;
+            index = threadpool::bucket_USER_INITIATED;
             break;
         case queue_priority::UTILITY:
         case queue_priority::DEFAULT:
-            index = bucket_UTILITY;
+            index = threadpool::bucket_UTILITY;
             break;
         case queue_priority::BACKGROUND:
-            index = bucket_BACKGROUND;
+            index = threadpool::bucket_BACKGROUND;
             break;
     }
 
     XDISPATCH_ASSERT(index >= 0);
-    const auto enqueued = m_data->m_operations[index].enqueue(work);
+    return index;
+}
+
+/**
+    @return the time to record for the next count operations
+
+    Only a sample of all operations gets timestamped to keep
+    the overhead of measuring the time spent waiting low.
+ */
+static clock::time_point
+sample_timestamp(unsigned count)
+{
+    static constexpr unsigned skWaitSampling = 64;
+    static thread_local unsigned s_executed = 0;
+    const auto previous = s_executed;
+    s_executed += count;
+    return (previous / skWaitSampling != s_executed / skWaitSampling)
+             ? clock::now()
+             : clock::time_point();
+}
+
+void
+threadpool::execute_unique(unique_operation&& work,
+                           const queue_priority priority)
+{
+    const int index = bucket_for(priority);
+    const auto timestamp = sample_timestamp(1);
+
+    queued_operation item(std::move(work), index, timestamp);
+
+    // work submitted from within one of our workers stays local so that
+    // it is picked up again by the same worker unless others go stealing.
+    // It is not counted by the semaphore, idle workers are woken by
+    // schedule() and will steal it. A full deque uses the buckets instead
+    if (s_local_deque && s_local_pool == this && current() == this &&
+        s_local_deque->push(item)) {
+        schedule();
+        return;
+    }
+
+    auto& token = m_data->producer().token(*m_data, index);
+    const auto enqueued =
+      m_data->m_operations[index].enqueue(token, std::move(item));
     XDISPATCH_ASSERT(enqueued);
     if (enqueued) {
         m_data->m_operations_counter.release();
@@ -288,10 +1344,183 @@ threadpool::execute(const operation_ptr& work, const queue_priority priority)
     schedule();
 }
 
+void
+threadpool::execute_bulk(std::vector<unique_operation>&& work,
+                         const queue_priority priority)
+{
+    if (work.empty()) {
+        return;
+    }
+
+    const int index = bucket_for(priority);
+    const auto count = static_cast<int>(work.size());
+    // a single timestamp is representative for the whole batch
+    auto timestamp = sample_timestamp(static_cast<unsigned>(count));
+
+    const bool local =
+      s_local_deque && s_local_pool == this && current() == this;
+    std::vector<queued_operation> items;
+    for (auto& op : work) {
+        queued_operation item(std::move(op), index, timestamp);
+        timestamp = clock::time_point();
+        // see execute_unique(), only a full deque uses the buckets
+        if (!local || !s_local_deque->push(item)) {
+            if (items.empty()) {
+                items.reserve(work.size());
+            }
+            items.push_back(std::move(item));
+        }
+    }
+
+    if (!items.empty()) {
+        // all items go into a single block of the queue at once
+        auto& token = m_data->producer().token(*m_data, index);
+        auto& operations = m_data->m_operations[index];
+        if (operations.enqueue_bulk(
+              token, std::make_move_iterator(items.begin()), items.size())) {
+            m_data->m_operations_counter.release(
+              static_cast<int>(items.size()));
+        } else {
+            // the queue failed to allocate a block large enough for all
+            // items at once leaving them untouched, queue them one by one
+            // as execute_unique() would so that none is dropped silently
+            int enqueued = 0;
+            for (auto& item : items) {
+                const bool success = operations.enqueue(token, std::move(item));
+                XDISPATCH_ASSERT(success);
+                if (success) {
+                    ++enqueued;
+                }
+            }
+            if (enqueued > 0) {
+                m_data->m_operations_counter.release(enqueued);
+            }
+        }
+    }
+    schedule(count);
+}
+
+void
+threadpool::weights(const bucket_weights& weights)
+{
+    for (int bucket = 0; bucket < bucket_count; ++bucket) {
+        m_data->m_weights[bucket].store(weights[bucket],
+                                        std::memory_order_relaxed);
+    }
+}
+
+threadpool::bucket_weights
+threadpool::weights() const
+{
+    bucket_weights weights;
+    for (int bucket = 0; bucket < bucket_count; ++bucket) {
+        weights[bucket] =
+          m_data->m_weights[bucket].load(std::memory_order_relaxed);
+    }
+    return weights;
+}
+
+void
+threadpool::aging(std::chrono::milliseconds threshold)
+{
+    m_data->m_aging.store(threshold.count(), std::memory_order_relaxed);
+}
+
+std::chrono::milliseconds
+threadpool::aging() const
+{
+    return std::chrono::milliseconds(
+      m_data->m_aging.load(std::memory_order_relaxed));
+}
+
+void
+threadpool::park_policy(const threadpool_park_policy& policy)
+{
+    m_data->m_spins.store(policy.spins, std::memory_order_relaxed);
+    m_data->m_adaptive.store(policy.adaptive, std::memory_order_relaxed);
+    m_data->m_yields.store(policy.yields, std::memory_order_relaxed);
+    m_data->m_park_timeout.store(policy.park_timeout.count(),
+                                 std::memory_order_relaxed);
+    const auto min_warm_threads =
+      std::max(policy.min_warm_threads, m_data->m_min_threads);
+    m_data->m_min_warm_threads.store(min_warm_threads,
+                                     std::memory_order_relaxed);
+
+    // spawn the warm threads upfront so that they are ready
+    // once the first operations get submitted
+    const auto max_threads =
+      m_data->m_max_threads.load(std::memory_order_consume);
+    const auto warm_threads =
+      std::min(max_threads, static_cast<int>(min_warm_threads));
+    while (m_data->m_active_threads.load(std::memory_order_consume) <
+           warm_threads) {
+        spawn_thread();
+    }
+}
+
+threadpool_park_policy
+threadpool::park_policy() const
+{
+    threadpool_park_policy policy;
+    policy.spins = m_data->m_spins.load(std::memory_order_relaxed);
+    policy.adaptive = m_data->m_adaptive.load(std::memory_order_relaxed);
+    policy.yields = m_data->m_yields.load(std::memory_order_relaxed);
+    policy.park_timeout = std::chrono::milliseconds(
+      m_data->m_park_timeout.load(std::memory_order_relaxed));
+    policy.min_warm_threads =
+      m_data->m_min_warm_threads.load(std::memory_order_relaxed);
+    return policy;
+}
+
+threadpool::bucket_statistics
+threadpool::statistics() const
+{
+    return m_data->statistics();
+}
+
+threadpool_wake_statistics
+threadpool::wake_statistics() const
+{
+    return m_data->wake_statistics();
+}
+
+void
+threadpool::siblings(const std::vector<std::shared_ptr<threadpool>>& pools)
+{
+    auto siblings = std::make_shared<data::sibling_list>();
+    for (const auto& pool : pools) {
+        if (pool.get() != this) {
+            siblings->push_back(pool);
+        }
+    }
+    m_data->siblings(siblings);
+}
+
+ithreadpool_ptr
+create_threadpool(const threadpool_config& config)
+{
+    if (config.numa) {
+        return std::make_shared<numa_threadpool>(config);
+    }
+    return std::make_shared<threadpool>(config);
+}
+
 ithreadpool_ptr
 backend::create_threadpool()
 {
-    return std::make_shared<threadpool>();
+    static const bool s_work_stealing = [] {
+        const char* value = std::getenv("XDISPATCH2_WORK_STEALING");
+        return (value && 1 == std::atoi(value));
+    }();
+    threadpool_config config;
+    config.work_stealing = s_work_stealing;
+    return create_threadpool(config);
+}
+
+ithreadpool_ptr
+backend::create_threadpool(const threadpool_config& config)
+{
+    return naive::create_threadpool(config);
 }
 
 ithreadpool_ptr
@@ -304,7 +1533,7 @@ backend::global_threadpool()
 }
 
 void
-threadpool::schedule()
+threadpool::schedule(int count)
 {
     // lets check if there is an idle thread first
     const int active_threads =
@@ -316,24 +1545,29 @@ threadpool::schedule()
     XDISPATCH_ASSERT(idle_threads <= active_threads &&
                      "We must never have more idle than active threads");
 
-    if (idle_threads > 0) {
-        // idle count will be decremented by thread waking up again
+    // wake one thread per operation but never more than needed
+    while (count > 0 && m_data->wake_idle()) {
         XDISPATCH_TP_TRACE(this, active_threads, idle_threads)
           << "Woke an idle thread";
+        --count;
     }
-    // check if we are good to create another thread
-    else if (active_threads <
-             m_data->m_max_threads.load(std::memory_order_consume)) {
-        auto thread = std::make_shared<worker>(m_data);
-        operation_queue_manager::instance().attach(thread);
-        m_data->m_active_threads.fetch_add(1, std::memory_order_release);
-
-        XDISPATCH_TP_TRACE(this, active_threads + 1, idle_threads)
-          << "Spawned thread " << thread->get_id()
-          << " (max=" << m_data->m_max_threads << ")";
+    // check if we are good to create more threads
+    while (count > 0 && m_data->request_worker()) {
+        XDISPATCH_TP_TRACE(this, active_threads, idle_threads)
+          << "Requested a new thread";
+        --count;
     }
     // all threads busy and processor allocation reached, wait
-    // and the operation will be picked up as soon as a thread is available
+    // and the operations will be picked up as soon as a thread is available
+    // or a worker of a sibling pool is about to idle, siblings are never
+    // woken so that each node only burns its own processors
+}
+
+void
+threadpool::spawn_thread()
+{
+    m_data->m_active_threads.fetch_add(1, std::memory_order_release);
+    m_data->spawn_worker();
 }
 
 void
@@ -346,7 +1580,10 @@ threadpool::notify_thread_blocked()
     const auto idle = m_data->m_idle_threads.load(std::memory_order_consume);
     XDISPATCH_TP_TRACE(this, active, idle)
       << "Increased threadcount to " << max_threads;
-    schedule();
+    // waking an idle thread would not help as there is no work for it
+    if (0 == idle) {
+        schedule();
+    }
 }
 
 void
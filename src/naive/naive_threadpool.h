@@ -22,6 +22,8 @@
 #ifndef XDISPATCH_NAIVE_THREADPOOL_H_
 #define XDISPATCH_NAIVE_THREADPOOL_H_
 
+#include "xdispatch/backend_naive_threadpool.h"
+
 #include "naive_thread.h"
 #include "naive_semaphore.h"
 #include "naive_concurrentqueue.h"
@@ -35,67 +37,6 @@ namespace naive {
 
 using thread_ptr = std::shared_ptr<std::thread>;
 
-/**
-    An implementation of ithreadpool executing in a single thread
-    for sake of simplicity.
- */
-class threadpool : public ithreadpool
-{
-public:
-    enum
-    {
-        bucket_USER_INTERACTIVE = 0,
-        bucket_USER_INITIATED = 1,
-        bucket_UTILITY = 2,
-        bucket_BACKGROUND = 3,
-
-        bucket_count
-    };
-
-    /**
-        @brief Constructor
-     */
-    threadpool();
-
-    /**
-        @brief Destructor
-     */
-    ~threadpool() override;
-
-    /**
-        @copydoc ithreadpool::execute
-     */
-    void execute(const operation_ptr& work, queue_priority priority) final;
-
-protected:
-    /**
-        @brief Marks a thread as blocked, i.e. waiting on a resource
-
-        Use this to notify the pool that it may spawn additional threads
-        without overallocating the system's processor count as the calling
-        thread is blocking on a resource
-     */
-    void notify_thread_blocked() final;
-
-    /**
-        @brief Marks a thread as unblocked, i.e. busy again
-
-        Use this to notify the pool that a previously blocked thread
-        has obtained its resource and will now make use of CPU resources
-        again.
-     */
-    void notify_thread_unblocked() final;
-
-private:
-    class worker;
-    class data;
-    using data_ptr = std::shared_ptr<data>;
-
-    void schedule();
-
-    data_ptr m_data;
-};
-
 } // namespace naive
 __XDISPATCH_END_NAMESPACE
 
@@ -23,8 +23,11 @@
 #include "xdispatch/impl/cancelable.h"
 #include "xdispatch/impl/iqueue_impl.h"
 
-#include "naive_threadpool.h"
-#include "naive_inverse_lockguard.h"
+#include "naive_timer_service.h"
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
 
 __XDISPATCH_BEGIN_NAMESPACE
 namespace naive {
@@ -34,16 +37,21 @@ class timer_impl
   , public std::enable_shared_from_this<timer_impl>
 {
 public:
-    timer_impl(const iqueue_impl_ptr& queue,
-               const ithreadpool_ptr& pool,
-               backend_type backend)
+    using clock = timer_service::clock;
+
+    timer_impl(const iqueue_impl_ptr& queue, backend_type backend)
       : itimer_impl()
       , m_backend(backend)
       , m_interval(0)
+      , m_leeway(leeway_of(timer_precision::DEFAULT))
       , m_queue(queue)
-      , m_pool(pool)
       , m_handler()
       , m_running(0)
+      , m_generation(0)
+      , m_deadline()
+      , m_delay(0)
+      , m_scheduled(0)
+      , m_in_flight(false)
       , m_cancelable()
     {}
 
@@ -59,9 +67,11 @@ public:
         m_interval = interval;
     }
 
-    void latency(timer_precision /* precision */
-                 ) final
-    {}
+    void latency(timer_precision precision) final
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_leeway = leeway_of(precision);
+    }
 
     void handler(const operation_ptr& op) final
     {
@@ -83,80 +93,150 @@ public:
             return;
         }
 
-        const auto this_ptr = shared_from_this();
-
-        // the timer will execute via a helper borrowed from the
-        // global default threadpool. It is ensured that enough
-        // threads are available for the pool even though the
-        // timer is blocking while it is active
-        auto timer_op = make_operation([this_ptr, delay] {
-            ithreadpool::block_scope blocked;
-            std::this_thread::sleep_for(delay);
-
-            std::unique_lock<std::mutex> lock(this_ptr->m_CS);
-            while (this_ptr->m_running > 0) {
-                const auto handler = this_ptr->m_handler;
-                const auto interval = this_ptr->m_interval;
-                const auto queue = this_ptr->m_queue;
-                auto& cancelable = this_ptr->m_cancelable;
-
-                inverse_lock_guard<std::mutex> unlock(this_ptr->m_CS);
-
-                lightweight_barrier barrier;
-                queue->async(make_operation([handler, &barrier, &cancelable] {
-                    cancelable_scope scope(cancelable);
-                    if (scope) {
-                        execute_operation_on_this_thread(*handler);
-                    }
-                    barrier.complete();
-                }));
-                barrier.wait();
-
-                if (interval.count() > 0) {
-                    std::this_thread::sleep_for(interval);
-                } else {
-                    // singleshot timer
-                    break;
-                }
-            }
-        });
-
-        // FIXME(zwicker): Add accessors to execute with the queue's priority
-        m_pool->execute(timer_op, queue_priority::DEFAULT);
+        m_deadline = clock::now() + delay;
+        m_delay = delay;
+        schedule(++m_generation);
     }
 
     void suspend() override
     {
-        std::lock_guard<std::mutex> lock(m_CS);
-        --m_running;
+        uint64_t scheduled = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_CS);
+            if (0 == --m_running) {
+                // invalidates the expiration scheduled already
+                ++m_generation;
+                std::swap(scheduled, m_scheduled);
+            }
+        }
+        unschedule(scheduled);
     }
 
     void cancel() override
     {
+        uint64_t scheduled = 0;
         {
             std::lock_guard<std::mutex> lock(m_CS);
             m_running = 0;
+            ++m_generation;
+            std::swap(scheduled, m_scheduled);
         }
+        unschedule(scheduled);
         m_cancelable.disable();
     }
 
     backend_type backend() final { return m_backend; }
 
 private:
+    static clock::duration leeway_of(timer_precision precision)
+    {
+        switch (precision) {
+            case timer_precision::COARSE:
+                return std::chrono::seconds(1);
+            case timer_precision::DEFAULT:
+                return std::chrono::milliseconds(5);
+            case timer_precision::PRECISE:
+                break;
+        }
+        return clock::duration(0);
+    }
+
+    // needs to be called with m_CS held
+    void schedule(uint64_t generation)
+    {
+        // timers with a leeway fire at multiples of it so that timers
+        // expiring at about the same time fire together. The leeway is
+        // kept small compared to the interval or the delay of singleshot
+        // timers so that e.g. a coarse after() is not late by a second
+        static constexpr int skMaxLeewayFraction = 10;
+        const auto period = m_interval.count() > 0 ? m_interval : m_delay;
+        const auto leeway =
+          std::min<clock::duration>(m_leeway, period / skMaxLeewayFraction);
+        auto deadline = m_deadline;
+        if (leeway.count() > 0) {
+            const auto since_epoch = deadline.time_since_epoch();
+            deadline = clock::time_point(
+              (since_epoch + leeway - clock::duration(1)) / leeway * leeway);
+        }
+
+        const auto this_ptr = shared_from_this();
+        m_scheduled = timer_service::instance().schedule(
+          deadline,
+          unique_operation(
+            [this_ptr, generation] { this_ptr->fire(generation); }));
+    }
+
+    // needs to be called without m_CS held as an expiration
+    // executing right now will be waited for
+    static void unschedule(uint64_t scheduled)
+    {
+        if (0 != scheduled) {
+            timer_service::instance().cancel(scheduled);
+        }
+    }
+
+    // executed on the timer thread
+    void fire(uint64_t generation)
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        if (generation != m_generation || m_running <= 0) {
+            // suspended or cancelled meanwhile
+            return;
+        }
+        m_scheduled = 0;
+
+        // expirations are merged while the handler is still executing
+        if (!m_in_flight && m_handler && m_queue) {
+            m_in_flight = true;
+            const auto this_ptr = shared_from_this();
+            const auto handler = m_handler;
+            m_queue->async_unique(unique_operation([this_ptr, handler] {
+                {
+                    cancelable_scope scope(this_ptr->m_cancelable);
+                    if (scope) {
+                        execute_operation_on_this_thread(*handler);
+                    }
+                }
+                std::lock_guard<std::mutex> lock(this_ptr->m_CS);
+                this_ptr->m_in_flight = false;
+            }));
+        }
+
+        if (m_interval.count() > 0) {
+            // skip all expirations missed so far but keep the phase
+            m_deadline += m_interval;
+            const auto now = clock::now();
+            if (m_deadline < now) {
+                m_deadline += (now - m_deadline) / m_interval * m_interval;
+                m_deadline += m_interval;
+            }
+            schedule(generation);
+        }
+        // singleshot timers stay resumed but will not fire again
+    }
+
     const backend_type m_backend;
     std::mutex m_CS;
     std::chrono::milliseconds m_interval;
+    clock::duration m_leeway;
     iqueue_impl_ptr m_queue;
-    ithreadpool_ptr m_pool;
     operation_ptr m_handler;
     int m_running;
+    // incremented whenever scheduled expirations become invalid
+    uint64_t m_generation;
+    clock::time_point m_deadline;
+    // the delay passed to resume()
+    std::chrono::milliseconds m_delay;
+    // the id of the expiration scheduled with the timer service
+    uint64_t m_scheduled;
+    bool m_in_flight;
     cancelable m_cancelable;
 };
 
 itimer_impl_ptr
 backend::create_timer(const iqueue_impl_ptr& queue, backend_type backend)
 {
-    return std::make_shared<timer_impl>(queue, global_threadpool(), backend);
+    return std::make_shared<timer_impl>(queue, backend);
 }
 
 } // namespace naive
@@ -0,0 +1,138 @@
+/*
+ * naive_timer_service.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_timer_service.h"
+#include "naive_inverse_lockguard.h"
+
+#include "../thread_utils.h"
+
+#include <algorithm>
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+uint64_t
+timer_service::schedule(clock::time_point deadline, unique_operation&& op)
+{
+    std::lock_guard<std::mutex> lock(m_CS);
+    const auto id = m_sequence++;
+    m_entries.push_back(entry{ deadline, id, std::move(op) });
+    std::push_heap(m_entries.begin(), m_entries.end(), &timer_service::later);
+
+    // only wake the thread when it needs to sleep for a shorter time
+    if (m_entries.front().m_sequence == id) {
+        m_cond.notify_one();
+    }
+    return id;
+}
+
+void
+timer_service::cancel(uint64_t id)
+{
+    unique_operation op;
+    {
+        std::unique_lock<std::mutex> lock(m_CS);
+        const auto it = std::find_if(
+          m_entries.begin(), m_entries.end(), [id](const entry& e) {
+              return e.m_sequence == id;
+          });
+        if (it != m_entries.end()) {
+            // removed right away so that cancelled timers do not pile up
+            // in the heap until their deadline
+            op = std::move(it->m_op);
+            *it = std::move(m_entries.back());
+            m_entries.pop_back();
+            std::make_heap(
+              m_entries.begin(), m_entries.end(), &timer_service::later);
+        } else if (std::this_thread::get_id() != m_thread.get_id()) {
+            m_completed.wait(lock, [this, id] { return m_executing != id; });
+        }
+    }
+    // released without holding the lock, it may schedule again
+    op.reset();
+}
+
+timer_service&
+timer_service::instance()
+{
+    // remark: intentionally leak this object so that timers may
+    // still be scheduled while other statics are destroyed
+    static auto* s_instance = new timer_service;
+    return *s_instance;
+}
+
+timer_service::timer_service()
+  : m_CS()
+  , m_cond()
+  , m_completed()
+  , m_entries()
+  , m_sequence(1)
+  , m_executing(0)
+  , m_thread(&timer_service::run, this)
+{}
+
+bool
+timer_service::later(const entry& a, const entry& b)
+{
+    if (a.m_deadline != b.m_deadline) {
+        return a.m_deadline > b.m_deadline;
+    }
+    return a.m_sequence > b.m_sequence;
+}
+
+void
+timer_service::run()
+{
+    thread_utils::set_current_thread_name("de.emzeat.xdispatch2.timers");
+    thread_utils::set_current_thread_priority(queue_priority::USER_INTERACTIVE);
+
+    std::unique_lock<std::mutex> lock(m_CS);
+    for (;;) {
+        if (m_entries.empty()) {
+            m_cond.wait(lock);
+            continue;
+        }
+
+        const auto deadline = m_entries.front().m_deadline;
+        if (clock::now() < deadline) {
+            m_cond.wait_until(lock, deadline);
+            continue;
+        }
+
+        std::pop_heap(
+          m_entries.begin(), m_entries.end(), &timer_service::later);
+        auto op = std::move(m_entries.back().m_op);
+        m_executing = m_entries.back().m_sequence;
+        m_entries.pop_back();
+
+        {
+            inverse_lock_guard<std::mutex> unlock(m_CS);
+            execute_operation_on_this_thread(op);
+            // release whatever the operation holds before locking again
+            op.reset();
+        }
+        m_executing = 0;
+        m_completed.notify_all();
+    }
+}
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
@@ -0,0 +1,105 @@
+/*
+ * naive_timer_service.h
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_TIMER_SERVICE_H_
+#define XDISPATCH_NAIVE_TIMER_SERVICE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "naive_backend_internal.h"
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief Executes operations at given points in time
+
+    All deadlines are kept in a single min-heap serviced by one thread
+    sleeping until the earliest deadline is due. Operations are executed
+    on the timer thread itself and must only dispatch the actual work to
+    a queue. Any number of timers can be active while only a single
+    thread is used for all of them.
+ */
+class timer_service
+{
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+        @brief Executes the given operation once the deadline passed
+
+        It is safe to call this function from multiple threads at the
+        same time and from within an operation executed by the service.
+
+        @return An id to be passed to cancel()
+     */
+    uint64_t schedule(clock::time_point deadline, unique_operation&& op);
+
+    /**
+        @brief Removes the operation with the given id
+
+        The operation is released right away if still pending. If it is
+        executing already the call blocks until it completed, unless made
+        from within an operation executed by the service. Either way the
+        operation will not be executing anymore once this returns.
+     */
+    void cancel(uint64_t id);
+
+    /**
+        @return The global instance of the timer service
+     */
+    static timer_service& instance();
+
+private:
+    timer_service();
+
+    struct entry
+    {
+        clock::time_point m_deadline;
+        // keeps entries with the same deadline in order
+        uint64_t m_sequence;
+        unique_operation m_op;
+    };
+
+    // orders the heap so that the earliest deadline is at its front
+    static bool later(const entry& a, const entry& b);
+
+    void run();
+
+    std::mutex m_CS;
+    std::condition_variable m_cond;
+    // signalled whenever an operation completed
+    std::condition_variable m_completed;
+    std::vector<entry> m_entries;
+    uint64_t m_sequence;
+    // the id of the operation executing right now
+    uint64_t m_executing;
+    std::thread m_thread;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif /* XDISPATCH_NAIVE_TIMER_SERVICE_H_ */
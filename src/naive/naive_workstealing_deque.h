@@ -0,0 +1,201 @@
+/*
+ * naive_workstealing_deque.h
+ *
+ * Copyright (c) 2011 - 2023 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef XDISPATCH_NAIVE_WORKSTEALING_DEQUE_H_
+#define XDISPATCH_NAIVE_WORKSTEALING_DEQUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#include "naive_backend_internal.h"
+
+__XDISPATCH_BEGIN_NAMESPACE
+namespace naive {
+
+/**
+    @brief A bounded Chase-Lev work-stealing deque
+
+    The deque is owned by a single thread which is the only one allowed to
+    push() and pop() items at the bottom. Any other thread may steal() items
+    from the top concurrently. The implementation follows "Correct and
+    Efficient Work-Stealing for Weak Memory Models" by Le et al.
+
+    Items are stored inline in a ring of fixed capacity so that pushing
+    does not allocate any memory. Different from the original algorithm a
+    slot is only read once the index of the item has been claimed, by
+    advancing the top or bottom, so items do not need to be trivially
+    copyable. A slot is marked free again once its item has been moved
+    out. The owner treats a slot a thief is still moving out of as full.
+ */
+template<typename T>
+class workstealing_deque
+{
+    static_assert(std::is_nothrow_move_assignable<T>::value,
+                  "Items need to be moved without throwing");
+
+public:
+    /**
+        @brief Constructs a new deque
+
+        @param capacity The capacity, needs to be a power of two
+     */
+    explicit workstealing_deque(size_t capacity = 256)
+      : m_top(0)
+      , m_bottom(0)
+      , m_mask(static_cast<int64_t>(capacity) - 1)
+      , m_slots(new slot[capacity])
+    {
+        XDISPATCH_ASSERT(capacity > 0 && 0 == (capacity & (capacity - 1)));
+    }
+
+    workstealing_deque(const workstealing_deque&) = delete;
+    workstealing_deque& operator=(const workstealing_deque&) = delete;
+
+    /**
+        @brief Pushes an item to the bottom of the deque
+
+        May only be called by the owning thread
+
+        @return false if the deque is full, item is left untouched then
+     */
+    bool push(T& item)
+    {
+        const auto bottom = m_bottom.load(std::memory_order_relaxed);
+        const auto top = m_top.load(std::memory_order_acquire);
+        if (bottom - top > m_mask) {
+            return false;
+        }
+        auto& s = m_slots[bottom & m_mask];
+        // pairs with the release in take(), a thief which claimed the
+        // previous item of this slot may still be moving it out
+        if (s.m_full.load(std::memory_order_acquire)) {
+            return false;
+        }
+        s.m_item = std::move(item);
+        s.m_full.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+        @brief Pops the item most recently pushed
+
+        May only be called by the owning thread
+
+        @return false if the deque was empty
+     */
+    bool pop(T& item)
+    {
+        const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        if (top == bottom) {
+            // last item, race against thieves
+            const bool won =
+              m_top.compare_exchange_strong(top,
+                                            top + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            if (!won) {
+                return false;
+            }
+        }
+        take(bottom, item);
+        return true;
+    }
+
+    /**
+        @brief Steals the item least recently pushed
+
+        May be called by any thread
+
+        @return false if the deque was empty or the race for the
+                item was lost to another thread
+     */
+    bool steal(T& item)
+    {
+        auto top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const auto bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return false;
+        }
+        if (!m_top.compare_exchange_strong(top,
+                                           top + 1,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed)) {
+            return false;
+        }
+        take(top, item);
+        return true;
+    }
+
+    /**
+        @return true if the deque appears to be empty
+
+        The result is a snapshot only and may be outdated as soon as it
+        is returned if other threads access the deque concurrently.
+     */
+    bool empty() const
+    {
+        const auto bottom = m_bottom.load(std::memory_order_relaxed);
+        const auto top = m_top.load(std::memory_order_relaxed);
+        return bottom <= top;
+    }
+
+private:
+    struct slot
+    {
+        // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+        T m_item;
+        // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+        std::atomic<bool> m_full{ false };
+    };
+
+    // moves out the item at an index claimed by the caller
+    void take(int64_t index, T& item)
+    {
+        auto& s = m_slots[index & m_mask];
+        item = std::move(s.m_item);
+        s.m_full.store(false, std::memory_order_release);
+    }
+
+    std::atomic<int64_t> m_top;
+    std::atomic<int64_t> m_bottom;
+    const int64_t m_mask;
+    std::unique_ptr<slot[]> m_slots;
+};
+
+} // namespace naive
+__XDISPATCH_END_NAMESPACE
+
+#endif /* XDISPATCH_NAIVE_WORKSTEALING_DEQUE_H_ */
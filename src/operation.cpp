@@ -20,6 +20,7 @@
  */
 
 #include "xdispatch_internal.h"
+#include "trace_utils.h"
 
 __XDISPATCH_BEGIN_NAMESPACE
 
@@ -27,11 +28,6 @@ void
 queue_operation_with_d(operation&, void*)
 {}
 
-template<typename... Params>
-void
-queue_operation_with_d(parameterized_operation<Params...>&, void*)
-{}
-
 template void
 queue_operation_with_d<size_t>(iteration_operation&, void*);
 
@@ -45,17 +41,27 @@ execute_operation_on_this_thread(operation& op)
     op();
 }
 
-template<typename... Params>
-XDISPATCH_EXPORT void
-execute_operation_on_this_thread(parameterized_operation<Params...>& op,
-                                 Params... params)
-{
-    op(params...);
-}
-
 template XDISPATCH_EXPORT void
 execute_operation_on_this_thread<size_t>(iteration_operation&, size_t);
 
+void
+report_unhandled_exception(const std::exception_ptr& exception) noexcept
+{
+    if (!exception) {
+        return;
+    }
+    try {
+        std::rethrow_exception(exception);
+    } catch (const std::exception& e) {
+        XDISPATCH_WARNING() << "Dropping an unhandled exception, please make "
+                               "sure to catch them before: "
+                            << e.what();
+    } catch (...) {
+        XDISPATCH_WARNING() << "Dropping an unhandled exception, please make "
+                               "sure to catch them before!";
+    }
+}
+
 template XDISPATCH_EXPORT void
 execute_operation_on_this_thread<socket_t, notifier_type>(
   socket_notifier_operation&,
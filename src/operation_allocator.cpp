@@ -0,0 +1,457 @@
+/*
+ * operation_allocator.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "xdispatch_internal.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+__XDISPATCH_BEGIN_NAMESPACE
+
+namespace {
+
+// every allocation is prefixed with a header, which also
+// keeps the memory handed out aligned by 16 bytes
+constexpr size_t kHeaderSize = 16;
+constexpr size_t kGranularity = 16;
+// allocations above 256 bytes are not pooled
+constexpr uint32_t kSizeClasses = 16;
+constexpr uint32_t kUnpooled = kSizeClasses;
+// the number of blocks released on a thread other than the
+// owning one before handing them back to their owner
+constexpr size_t kRemoteBatchSize = 32;
+constexpr size_t kRemoteBatchSlots = 4;
+// the number of bytes a thread keeps in its free lists at most, blocks
+// released beyond that are handed back to the global allocator
+constexpr size_t kMaxCachedBytes = 1024 * 1024;
+
+class thread_cache;
+
+struct block
+{
+    // the cache the block is to be returned to or null if not pooled
+    thread_cache* m_owner;
+    uint32_t m_size_class;
+    // overlaps with the payload and is only valid while the block is free
+    block* m_next;
+};
+static_assert(offsetof(block, m_next) == kHeaderSize,
+              "The header of a block must be kHeaderSize bytes");
+
+inline void*
+payload_of(block* b)
+{
+    return reinterpret_cast<char*>(b) + kHeaderSize;
+}
+
+inline size_t
+bytes_of(uint32_t size_class)
+{
+    return kHeaderSize + (size_class + 1) * kGranularity;
+}
+
+inline block*
+block_of(void* payload)
+{
+    return reinterpret_cast<block*>(static_cast<char*>(payload) -
+                                    kHeaderSize);
+}
+
+// counters are written by a single thread only
+inline void
+increment(std::atomic<uint64_t>& counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+}
+
+/**
+    @brief The free lists owned by a single thread
+
+    Only the owning thread may access the free lists, all other threads
+    return blocks using the lockfree remote list instead. Caches are never
+    destroyed but adopted by a new thread once their owner exited.
+ */
+class thread_cache
+{
+public:
+    thread_cache()
+      : m_allocations(0)
+      , m_recycled(0)
+      , m_trimmed(0)
+      , m_free()
+      , m_cached_bytes(0)
+      , m_remote(nullptr)
+    {
+        m_free.fill(nullptr);
+    }
+
+    block* pop(uint32_t size_class)
+    {
+        auto* b = m_free[size_class];
+        if (nullptr == b) {
+            collect_remote();
+            b = m_free[size_class];
+        }
+        if (b) {
+            m_free[size_class] = b->m_next;
+            m_cached_bytes -= bytes_of(size_class);
+        }
+        return b;
+    }
+
+    void push(block* b)
+    {
+        // the free lists must not keep all memory of a burst of
+        // operations forever, they only keep up to the high-water mark
+        const auto bytes = bytes_of(b->m_size_class);
+        if (m_cached_bytes + bytes > kMaxCachedBytes) {
+            ::operator delete(b);
+            increment(m_trimmed);
+            return;
+        }
+        m_cached_bytes += bytes;
+        b->m_next = m_free[b->m_size_class];
+        m_free[b->m_size_class] = b;
+    }
+
+    void push_remote(block* first, block* last)
+    {
+        auto* head = m_remote.load(std::memory_order_relaxed);
+        do {
+            last->m_next = head;
+        } while (!m_remote.compare_exchange_weak(
+          head, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<uint64_t> m_allocations;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<uint64_t> m_recycled;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<uint64_t> m_trimmed;
+
+private:
+    void collect_remote()
+    {
+        auto* b = m_remote.exchange(nullptr, std::memory_order_acquire);
+        while (b) {
+            auto* next = b->m_next;
+            push(b);
+            b = next;
+        }
+    }
+
+    std::array<block*, kSizeClasses> m_free;
+    size_t m_cached_bytes;
+    std::atomic<block*> m_remote;
+};
+
+class cache_registry
+{
+public:
+    static cache_registry& instance()
+    {
+        // never destroyed as blocks may be released during shutdown
+        static auto* s_instance = new cache_registry;
+        return *s_instance;
+    }
+
+    thread_cache* acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        if (m_abandoned.empty()) {
+            m_caches.push_back(new thread_cache);
+            return m_caches.back();
+        }
+        auto* cache = m_abandoned.back();
+        m_abandoned.pop_back();
+        return cache;
+    }
+
+    void release(thread_cache* cache)
+    {
+        std::lock_guard<std::mutex> lock(m_CS);
+        m_abandoned.push_back(cache);
+    }
+
+    operation_allocator_statistics statistics()
+    {
+        operation_allocator_statistics statistics;
+        statistics.allocations =
+          m_unowned_allocations.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(m_CS);
+        for (const auto* cache : m_caches) {
+            statistics.allocations +=
+              cache->m_allocations.load(std::memory_order_relaxed);
+            statistics.recycled +=
+              cache->m_recycled.load(std::memory_order_relaxed);
+            statistics.trimmed +=
+              cache->m_trimmed.load(std::memory_order_relaxed);
+        }
+        return statistics;
+    }
+
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    std::atomic<uint64_t> m_unowned_allocations{ 0 };
+
+private:
+    cache_registry() = default;
+
+    std::mutex m_CS;
+    std::vector<thread_cache*> m_caches;
+    std::vector<thread_cache*> m_abandoned;
+};
+
+/**
+    @brief Blocks released on this thread to be returned to another one
+ */
+struct remote_batch
+{
+    void flush()
+    {
+        if (m_first) {
+            m_owner->push_remote(m_first, m_last);
+        }
+        m_owner = nullptr;
+        m_first = nullptr;
+        m_last = nullptr;
+        m_count = 0;
+    }
+
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    thread_cache* m_owner = nullptr;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    block* m_first = nullptr;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    block* m_last = nullptr;
+    // NOLINTNEXTLINE(misc-non-private-member-variables-in-classes)
+    size_t m_count = 0;
+};
+
+// kept separate from the thread_state so that accessing
+// them does not require any checks for initialization
+thread_local thread_cache* s_cache = nullptr;
+thread_local bool s_exited = false;
+
+/**
+    @brief Hands back all resources when a thread exits
+ */
+class thread_state
+{
+public:
+    ~thread_state()
+    {
+        flush();
+        if (s_cache) {
+            cache_registry::instance().release(s_cache);
+            s_cache = nullptr;
+        }
+        s_exited = true;
+    }
+
+    void adopt_cache() { s_cache = cache_registry::instance().acquire(); }
+
+    void flush()
+    {
+        for (auto& batch : m_batches) {
+            batch.flush();
+        }
+    }
+
+    remote_batch& batch_for(const thread_cache* owner)
+    {
+        const auto hash = reinterpret_cast<uintptr_t>(owner) / sizeof(void*);
+        return m_batches[hash % kRemoteBatchSlots];
+    }
+
+private:
+    std::array<remote_batch, kRemoteBatchSlots> m_batches;
+};
+
+thread_local thread_state s_state;
+
+bool
+is_pooling_enabled_by_env()
+{
+    const char* value = std::getenv("XDISPATCH2_OPERATION_POOLING");
+    return (nullptr == value || 1 == std::atoi(value));
+}
+
+std::atomic<bool> s_pooling_enabled(is_pooling_enabled_by_env());
+
+thread_cache*
+local_cache()
+{
+    if (nullptr == s_cache && !s_exited) {
+        s_state.adopt_cache();
+    }
+    return s_cache;
+}
+
+void
+count_allocation()
+{
+    if (s_cache) {
+        increment(s_cache->m_allocations);
+    } else {
+        cache_registry::instance().m_unowned_allocations.fetch_add(
+          1, std::memory_order_relaxed);
+    }
+}
+
+void*
+allocate_block(thread_cache* owner, uint32_t size_class, size_t size)
+{
+    auto* b = static_cast<block*>(::operator new(kHeaderSize + size));
+    b->m_owner = owner;
+    b->m_size_class = size_class;
+    count_allocation();
+    return payload_of(b);
+}
+
+/**
+    @brief Allocates memory aligned by more than a block header guarantees
+
+    The address to release is stored right before the memory handed out.
+ */
+void*
+allocate_aligned(size_t size, size_t alignment)
+{
+    auto* raw =
+      static_cast<char*>(::operator new(sizeof(void*) + alignment + size));
+    const auto first = reinterpret_cast<uintptr_t>(raw + sizeof(void*));
+    auto* payload =
+      reinterpret_cast<void**>((first + alignment - 1) & ~(alignment - 1));
+    payload[-1] = raw;
+    count_allocation();
+    return payload;
+}
+
+} // namespace
+
+void*
+allocate_operation(size_t size)
+{
+    const auto size_class =
+      static_cast<uint32_t>((std::max<size_t>(size, 1) - 1) / kGranularity);
+    if (size_class >= kSizeClasses ||
+        !s_pooling_enabled.load(std::memory_order_relaxed)) {
+        return allocate_block(nullptr, kUnpooled, size);
+    }
+
+    auto* cache = local_cache();
+    if (nullptr == cache) {
+        // the thread is exiting already
+        return allocate_block(nullptr, kUnpooled, size);
+    }
+    if (auto* b = cache->pop(size_class)) {
+        increment(cache->m_recycled);
+        return payload_of(b);
+    }
+    return allocate_block(cache, size_class, (size_class + 1) * kGranularity);
+}
+
+void
+deallocate_operation(void* memory, size_t /* size */)
+{
+    if (nullptr == memory) {
+        return;
+    }
+
+    auto* b = block_of(memory);
+    auto* owner = b->m_owner;
+    if (nullptr == owner) {
+        ::operator delete(b);
+    } else if (owner == s_cache) {
+        owner->push(b);
+    } else if (s_exited) {
+        owner->push_remote(b, b);
+    } else {
+        // collect blocks of the same owner so that handing them
+        // back costs a single atomic operation per batch
+        auto& batch = s_state.batch_for(owner);
+        if (batch.m_owner != owner) {
+            batch.flush();
+            batch.m_owner = owner;
+            batch.m_last = b;
+        }
+        b->m_next = batch.m_first;
+        batch.m_first = b;
+        if (++batch.m_count >= kRemoteBatchSize) {
+            batch.flush();
+        }
+    }
+}
+
+void*
+allocate_operation(size_t size, size_t alignment)
+{
+    if (alignment <= kHeaderSize) {
+        return allocate_operation(size);
+    }
+    return allocate_aligned(size, alignment);
+}
+
+void
+deallocate_operation(void* memory, size_t size, size_t alignment)
+{
+    if (alignment <= kHeaderSize) {
+        deallocate_operation(memory, size);
+    } else if (nullptr != memory) {
+        ::operator delete(static_cast<void**>(memory)[-1]);
+    }
+}
+
+void
+flush_operation_deallocations()
+{
+    if (!s_exited) {
+        s_state.flush();
+    }
+}
+
+void
+operation_pooling(bool enabled)
+{
+    s_pooling_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool
+operation_pooling()
+{
+    return s_pooling_enabled.load(std::memory_order_relaxed);
+}
+
+operation_allocator_statistics
+operation_allocations()
+{
+    return cache_registry::instance().statistics();
+}
+
+__XDISPATCH_END_NAMESPACE
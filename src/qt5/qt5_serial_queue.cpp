@@ -31,7 +31,9 @@
 __XDISPATCH_BEGIN_NAMESPACE
 namespace qt5 {
 
-class ExecuteOperationEvent : public QEvent
+class ExecuteOperationEvent
+  : public QEvent
+  , public pooled_allocation
 {
 public:
     static QEvent::Type Type()
@@ -45,7 +45,9 @@ void
 ThreadPoolProxy::execute(const operation_ptr& work,
                          const queue_priority priority)
 {
-    class OperationRunnable : public QRunnable
+    class OperationRunnable
+      : public QRunnable
+      , public pooled_allocation
     {
     public:
         OperationRunnable(const operation_ptr& op, naive::ithreadpool* pool)
@@ -38,6 +38,7 @@ public:
     ~ThreadPoolProxy() override;
 
     void execute(const operation_ptr& work, queue_priority priority) final;
+    bool thread_bound() const final { return false; }
     void notify_thread_blocked() final;
     void notify_thread_unblocked() final;
 
@@ -40,11 +40,28 @@ queue::async(const operation_ptr& op) const
 }
 
 void
-queue::apply(size_t times, const iteration_operation_ptr& op) const
+queue::async(unique_operation&& op) const
+{
+    XDISPATCH_ASSERT(op);
+    m_impl->async_unique(std::move(op));
+}
+
+void
+queue::async_bulk(std::vector<unique_operation>&& ops) const
+{
+    if (!ops.empty()) {
+        m_impl->async_bulk(std::move(ops));
+    }
+}
+
+void
+queue::apply(size_t times,
+             const iteration_operation_ptr& op,
+             size_t grain) const
 {
     XDISPATCH_ASSERT(op);
     queue_operation_with_d(*op, m_impl.get());
-    m_impl->apply(times, op);
+    m_impl->apply_chunked(times, op, grain);
 }
 
 void
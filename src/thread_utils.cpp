@@ -30,6 +30,11 @@
     #include <sys/prctl.h>
 #endif
 
+#if (defined XDISPATCH2_HAVE_PTHREAD_SETAFFINITY_NP)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
 #if (defined XDISPATCH2_HAVE_SETPRIORITY)
     #include <sys/time.h>
     #include <sys/resource.h>
@@ -155,6 +160,37 @@ thread_utils::set_current_thread_priority(queue_priority priority)
 #endif
 }
 
+bool
+thread_utils::set_current_thread_affinity(const std::vector<int>& cpus)
+{
+#if (defined XDISPATCH2_HAVE_PTHREAD_SETAFFINITY_NP)
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            XDISPATCH_WARNING() << "Invalid processor " << cpu
+                                << " for thread affinity";
+            return false;
+        }
+        CPU_SET(cpu, &set);
+    }
+    const auto err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) {
+        XDISPATCH_WARNING() << "Failed to set affinity for thread: "
+                            << strerror(err);
+        return false;
+    }
+    return true;
+
+#else
+
+    static_cast<void>(cpus);
+    return false;
+
+#endif
+}
+
 #if (defined XDISPATCH2_HAVE_PTHREAD_SET_QOS_CLASS_SELF_NP)
 
 qos_class_t
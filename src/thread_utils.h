@@ -24,6 +24,8 @@
 
 #include "xdispatch/dispatch.h"
 
+#include <vector>
+
 #if (defined XDISPATCH2_HAVE_PTHREAD_SET_QOS_CLASS_SELF_NP)
     #include <pthread.h>
     #include <sys/qos.h>
@@ -53,6 +55,16 @@ public:
      */
     static void set_current_thread_priority(queue_priority priority);
 
+    /**
+        @brief Restricts the current thread to the given processors
+
+        @param cpus The indices of the processors to run on
+
+        @returns false if the affinity could not be changed or changing
+                 it is not supported on this platform
+     */
+    static bool set_current_thread_affinity(const std::vector<int>& cpus);
+
 #if (defined XDISPATCH2_HAVE_PTHREAD_SET_QOS_CLASS_SELF_NP)
     /**
         @returns the queue_priority mapped to the related qos class
@@ -149,7 +149,7 @@ public:
     void apply(size_t times, const iteration_operation_ptr& op) override
     {
         for (size_t i = 0; i < times; ++i) {
-            async(std::make_shared<naive::apply_operation>(i, op));
+            async(make_pooled_operation<naive::apply_operation>(i, op));
         }
         m_worker->wait_for_all();
     }
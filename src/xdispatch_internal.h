@@ -76,9 +76,29 @@ queue_operation_with_d(operation&, void*);
 void
 execute_operation_on_this_thread(operation&);
 
+// defined here so that backends can instantiate these
+// for the parameters of the operations they provide
+template<typename... Params>
+void
+queue_operation_with_d(parameterized_operation<Params...>&, void*)
+{}
+
+template<typename... Params>
+XDISPATCH_EXPORT void
+execute_operation_on_this_thread(parameterized_operation<Params...>& op,
+                                 Params... params)
+{
+    op(params...);
+}
+
 ibackend&
 backend_for_type(backend_type type);
 
+// hands back memory of operations released by the calling thread
+// to the threads which allocated it, call before going idle
+void
+flush_operation_deallocations();
+
 __XDISPATCH_END_NAMESPACE
 
 #undef __XDISPATCH_INDIRECT__
@@ -22,20 +22,60 @@
 
 #include <xdispatch/dispatch>
 #include <xdispatch/barrier_operation.h>
+#include <xdispatch/future.h>
+#include <algorithm>
 #include <atomic>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "cxx_tests.h"
 #include "stopwatch.h"
 
 constexpr int kCOUNT = 100000;
 
+// the free lists used for operations need to grow during the first
+// runs, use XDISPATCH2_OPERATION_POOLING=0 to compare without them
+static void
+report_allocations(const xdispatch::operation_allocator_statistics& before)
+{
+    const auto after = xdispatch::operation_allocations();
+    MU_MESSAGE("Allocated %i operations, %i recycled",
+               int(after.allocations - before.allocations),
+               int(after.recycled - before.recycled));
+}
+
+// the number of threads of this process or -1 if unknown
+static int
+process_threads()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (0 == line.compare(0, 8, "Threads:")) {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+enum class submission
+{
+    OPERATION,
+    LAMBDA,
+    BULK
+};
+
 template<class receiver>
 void
-do_benchmark(receiver& r)
+do_benchmark(receiver& r, submission mode = submission::OPERATION)
 {
     Stopwatch watch_execution;
     Stopwatch watch_dispatch;
     std::atomic<int> passes(0);
+    const auto allocations = xdispatch::operation_allocations();
 
     // begin measurement
     watch_execution.start();
@@ -43,9 +83,28 @@ do_benchmark(receiver& r)
 
     // schedule kCOUNT empty lambda blocks to measure the overhead
     // spent on scheduling the given queue
-    auto work = xdispatch::make_operation([&passes] { ++passes; });
-    for (int i = 0; i < kCOUNT; ++i) {
-        r.async(work);
+    if (submission::LAMBDA == mode) {
+        // a new operation every time as done by most users
+        for (int i = 0; i < kCOUNT; ++i) {
+            r.async([&passes] { ++passes; });
+        }
+    } else if (submission::BULK == mode) {
+        // the same operations but queued in batches
+        constexpr int kBATCH = 64;
+        std::vector<xdispatch::unique_operation> batch;
+        batch.reserve(kBATCH);
+        for (int i = 0; i < kCOUNT; i += kBATCH) {
+            for (int j = i; j < std::min(i + kBATCH, kCOUNT); ++j) {
+                batch.emplace_back([&passes] { ++passes; });
+            }
+            r.async_bulk(batch.begin(), batch.end());
+            batch.clear();
+        }
+    } else {
+        auto work = xdispatch::make_operation([&passes] { ++passes; });
+        for (int i = 0; i < kCOUNT; ++i) {
+            r.async(work);
+        }
     }
     watch_dispatch.stop();
 
@@ -61,6 +120,7 @@ do_benchmark(receiver& r)
     MU_MESSAGE("Executed %i operations, %i nsec per operation",
                actual,
                watch_execution.elapsed() * 1000 / actual);
+    report_allocations(allocations);
 }
 
 void
@@ -87,6 +147,241 @@ cxx_benchmark_global_queue(void* data)
     MU_END_TEST;
 }
 
+void
+cxx_benchmark_serial_queue_lambda(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_serial_queue_lambda);
+
+    auto queue = cxx_create_queue("cxx_benchmark_serial_queue_lambda");
+    do_benchmark(queue, submission::LAMBDA);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+cxx_benchmark_global_queue_lambda(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_global_queue_lambda);
+
+    auto queue = cxx_global_queue();
+    do_benchmark(queue, submission::LAMBDA);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+cxx_benchmark_serial_queue_bulk(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_serial_queue_bulk);
+
+    auto queue = cxx_create_queue("cxx_benchmark_serial_queue_bulk");
+    do_benchmark(queue, submission::BULK);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+cxx_benchmark_global_queue_bulk(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_global_queue_bulk);
+
+    auto queue = cxx_global_queue();
+    do_benchmark(queue, submission::BULK);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+/*
+ Measures the cost of queueing from many threads at the same time
+ */
+static void
+do_producers_benchmark(const xdispatch::queue& queue, int producers)
+{
+    Stopwatch watch_execution;
+    Stopwatch watch_dispatch;
+    std::atomic<int> passes(0);
+    const int per_producer = kCOUNT / producers;
+    const int total = per_producer * producers;
+    auto work = xdispatch::make_operation([&passes] { ++passes; });
+
+    // begin measurement
+    watch_execution.start();
+    watch_dispatch.start();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, &work, per_producer] {
+            for (int i = 0; i < per_producer; ++i) {
+                queue.async(work);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    watch_dispatch.stop();
+
+    while (passes < total) {
+        std::this_thread::yield();
+    }
+    watch_execution.stop();
+
+    MU_MESSAGE("%i producers dispatched %i operations, %i nsec per operation",
+               producers,
+               total,
+               watch_dispatch.elapsed() * 1000 / total);
+    MU_MESSAGE("%i producers executed %i operations, %i nsec per operation",
+               producers,
+               total,
+               watch_execution.elapsed() * 1000 / total);
+}
+
+void
+cxx_benchmark_global_queue_producers(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_global_queue_producers);
+
+    auto queue = cxx_global_queue();
+    for (const int producers : { 1, 8, 64 }) {
+        do_producers_benchmark(queue, producers);
+    }
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+/*
+ Measures the cost of an operation queueing the next one onto
+ its own queue as done by actor style code
+ */
+void
+cxx_benchmark_serial_queue_self_post(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_serial_queue_self_post);
+
+    auto queue = cxx_create_queue("cxx_benchmark_serial_queue_self_post");
+    auto barrier = std::make_shared<xdispatch::barrier_operation>();
+    std::function<void(int)> step;
+    step = [&queue, &step, &barrier](int remaining) {
+        if (0 == remaining) {
+            (*barrier)();
+        } else {
+            queue.async([&step, remaining] { step(remaining - 1); });
+        }
+    };
+
+    Stopwatch watch;
+    watch.start();
+    queue.async([&step] { step(kCOUNT); });
+    MU_ASSERT_TRUE(barrier->wait());
+    watch.stop();
+
+    MU_MESSAGE("Executed %i operations, %i nsec per operation",
+               kCOUNT,
+               watch.elapsed() * 1000 / kCOUNT);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+static xdispatch::task<>
+hop_between(xdispatch::queue first, xdispatch::queue second, int hops)
+{
+    for (int i = 0; i < hops; i += 2) {
+        co_await xdispatch::schedule(first);
+        co_await xdispatch::schedule(second);
+    }
+}
+
+static xdispatch::task<>
+run_hops(xdispatch::queue first,
+         xdispatch::queue second,
+         std::shared_ptr<xdispatch::barrier_operation> barrier)
+{
+    co_await hop_between(first, second, kCOUNT);
+    (*barrier)();
+}
+#endif
+
+/*
+ Measures the cost of a coroutine moving between two queues
+ */
+void
+cxx_benchmark_coroutine_schedule(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_coroutine_schedule);
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+    auto first = cxx_create_queue("cxx_benchmark_coroutine_schedule_1");
+    auto second = cxx_create_queue("cxx_benchmark_coroutine_schedule_2");
+    auto barrier = std::make_shared<xdispatch::barrier_operation>();
+    const auto allocations = xdispatch::operation_allocations();
+
+    Stopwatch watch;
+    watch.start();
+    run_hops(first, second, barrier).start(first);
+    MU_ASSERT_TRUE(barrier->wait());
+    watch.stop();
+
+    MU_MESSAGE("Resumed %i times, %i nsec per resumption",
+               kCOUNT,
+               watch.elapsed() * 1000 / kCOUNT);
+    report_allocations(allocations);
+
+    MU_PASS("Test completed");
+#else
+    MU_MESSAGE("SKIPPED: Coroutines are not supported by the compiler");
+    MU_PASS("Skipped");
+#endif
+    MU_END_TEST;
+}
+
+/*
+ Measures the cost of computing a value on one queue and passing
+ it on to a continuation executing on another queue
+ */
+void
+cxx_benchmark_future_then(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_future_then);
+
+    auto first = cxx_create_queue("cxx_benchmark_future_then_1");
+    auto second = cxx_create_queue("cxx_benchmark_future_then_2");
+    std::vector<xdispatch::future<int>> futures;
+    futures.reserve(kCOUNT);
+    const auto allocations = xdispatch::operation_allocations();
+
+    Stopwatch watch_dispatch;
+    Stopwatch watch_execution;
+    watch_execution.start();
+    watch_dispatch.start();
+    for (int i = 0; i < kCOUNT; ++i) {
+        futures.push_back(
+          xdispatch::async(first, [i] { return i; })
+            .then(second, [](int value) { return value + 1; }));
+    }
+    watch_dispatch.stop();
+    const auto values = xdispatch::when_all(std::move(futures)).get();
+    watch_execution.stop();
+
+    MU_ASSERT_EQUAL(values.size(), kCOUNT);
+    MU_MESSAGE("Dispatched %i futures, %i nsec per future",
+               kCOUNT,
+               watch_dispatch.elapsed() * 1000 / kCOUNT);
+    MU_MESSAGE("Completed %i futures, %i nsec per future",
+               kCOUNT,
+               watch_execution.elapsed() * 1000 / kCOUNT);
+    report_allocations(allocations);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
 void
 cxx_benchmark_group(void* data)
 {
@@ -98,6 +393,7 @@ cxx_benchmark_group(void* data)
     Stopwatch watch_execution;
     Stopwatch watch_dispatch;
     std::atomic<int> passes(0);
+    const auto allocations = xdispatch::operation_allocations();
 
     // begin measurement
     watch_execution.start();
@@ -116,12 +412,13 @@ cxx_benchmark_group(void* data)
 
     // notify on completion
     group.notify(
-      [&watch_execution, &passes] {
+      [&watch_execution, &passes, allocations] {
           watch_execution.stop();
           const int actual = passes;
           MU_MESSAGE("Executed %i operations, %i nsec per operation",
                      actual,
                      watch_execution.elapsed() * 1000 / actual);
+          report_allocations(allocations);
           MU_PASS("Test completed");
       },
       queue);
@@ -131,3 +428,188 @@ cxx_benchmark_group(void* data)
     MU_FAIL("Should never reach this");
     MU_END_TEST;
 }
+
+/*
+ Measures many groups waiting for completion at the same time
+ */
+void
+cxx_benchmark_group_concurrent(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_group_concurrent);
+
+    constexpr int kGROUPS = 10000;
+    auto queue = cxx_create_queue("cxx_benchmark_group_concurrent");
+    auto global = cxx_global_queue();
+    const int threads_before = process_threads();
+
+    // hold back all operations of the groups until all were notified
+    xdispatch::barrier_operation gate;
+    queue.async([&gate] { gate.wait(); });
+
+    Stopwatch watch_dispatch;
+    Stopwatch watch_execution;
+    watch_dispatch.start();
+    std::atomic<int> notified(0);
+    auto done = std::make_shared<xdispatch::barrier_operation>();
+    auto work = xdispatch::make_operation([] {});
+    auto notification =
+      xdispatch::make_operation([&notified, done] {
+          if (kGROUPS == ++notified) {
+              (*done)();
+          }
+      });
+    for (int i = 0; i < kGROUPS; ++i) {
+        auto group = cxx_create_group();
+        group.async(work, queue);
+        group.notify(notification, global);
+    }
+    watch_dispatch.stop();
+    // give the implementation a chance to spin up threads
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const int threads_pending = process_threads();
+
+    watch_execution.start();
+    gate();
+    MU_ASSERT_TRUE(done->wait());
+    watch_execution.stop();
+
+    MU_MESSAGE("Dispatched %i groups, %i nsec per group",
+               kGROUPS,
+               watch_dispatch.elapsed() * 1000 / kGROUPS);
+    MU_MESSAGE("Notified %i groups, %i nsec per group",
+               kGROUPS,
+               watch_execution.elapsed() * 1000 / kGROUPS);
+    MU_MESSAGE("%i threads before, %i threads while pending",
+               threads_before,
+               threads_pending);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+static void
+fork_join(const xdispatch::queue& queue,
+          int depth,
+          const std::shared_ptr<std::atomic<int>>& leaves,
+          const std::function<void()>& completed)
+{
+    if (0 == depth) {
+        if (1 == leaves->fetch_sub(1)) {
+            completed();
+        }
+        return;
+    }
+
+    // fan out from within the queue itself, this is what makes
+    // pool implementations with local queues shine
+    for (int i = 0; i < 2; ++i) {
+        queue.async([queue, depth, leaves, completed] {
+            fork_join(queue, depth - 1, leaves, completed);
+        });
+    }
+}
+
+void
+cxx_benchmark_fork_join(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_fork_join);
+
+    constexpr int kDEPTH = 17;
+    auto queue = cxx_global_queue();
+    auto leaves = std::make_shared<std::atomic<int>>(1 << kDEPTH);
+
+    const auto allocations = xdispatch::operation_allocations();
+
+    Stopwatch watch_execution;
+    watch_execution.start();
+    queue.async([queue, leaves, &watch_execution, allocations] {
+        fork_join(queue, kDEPTH, leaves, [&watch_execution, allocations] {
+            watch_execution.stop();
+            const int operations = (2 << kDEPTH) - 1;
+            MU_MESSAGE("Forked %i operations, %i nsec per operation",
+                       operations,
+                       watch_execution.elapsed() * 1000 / operations);
+            report_allocations(allocations);
+            MU_PASS("Test completed");
+        });
+    });
+
+    cxx_exec();
+
+    MU_FAIL("Should never reach this");
+    MU_END_TEST;
+}
+
+void
+cxx_benchmark_apply(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_apply);
+
+    constexpr int kITERATIONS = 10 * kCOUNT;
+    auto queue = cxx_global_queue();
+    std::atomic<int> passes(0);
+    const auto allocations = xdispatch::operation_allocations();
+
+    Stopwatch watch_execution;
+    watch_execution.start();
+    queue.apply(kITERATIONS, [&passes](size_t) {
+        passes.fetch_add(1, std::memory_order_relaxed);
+    });
+    watch_execution.stop();
+
+    MU_ASSERT_EQUAL(passes, kITERATIONS);
+    MU_MESSAGE("Applied %i iterations, %i nsec per iteration",
+               kITERATIONS,
+               watch_execution.elapsed() * 1000 / kITERATIONS);
+    report_allocations(allocations);
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+// counts each thread calling this for the first time
+static void
+count_thread(std::atomic<int>& threads)
+{
+    static thread_local bool s_counted = false;
+    if (!s_counted) {
+        s_counted = true;
+        ++threads;
+    }
+}
+
+void
+cxx_benchmark_apply_nested(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_benchmark_apply_nested);
+
+    constexpr int kOUTER = 64;
+    constexpr int kINNER = kCOUNT / 10;
+    auto queue = cxx_global_queue();
+    std::atomic<int> passes(0);
+    std::atomic<int> threads(0);
+
+    // every outer iteration is waiting for its inner iterations,
+    // this must not cause additional threads to be spawned
+    Stopwatch watch_execution;
+    watch_execution.start();
+    queue.apply(kOUTER, [&queue, &passes, &threads](size_t) {
+        count_thread(threads);
+        queue.apply(kINNER, [&passes, &threads](size_t) {
+            count_thread(threads);
+            passes.fetch_add(1, std::memory_order_relaxed);
+        });
+    });
+    watch_execution.stop();
+
+    MU_ASSERT_EQUAL(passes, kOUTER * kINNER);
+    MU_MESSAGE("Applied %i iterations, %i nsec per iteration",
+               kOUTER * kINNER,
+               watch_execution.elapsed() * 1000 / (kOUTER * kINNER));
+    MU_MESSAGE("Executed on %i threads with %i cores",
+               int(threads),
+               int(std::thread::hardware_concurrency()));
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
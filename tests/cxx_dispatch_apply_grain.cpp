@@ -0,0 +1,70 @@
+/*
+ * cxx_dispatch_apply_grain.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <atomic>
+#include <memory>
+
+/*
+ Checks that every iteration is executed exactly once
+ regardless of the grain chosen for an apply
+ */
+
+static void
+check_apply(const xdispatch::queue& q, size_t times, size_t grain)
+{
+    std::unique_ptr<std::atomic<int>[]> executed(new std::atomic<int>[times]);
+    for (size_t i = 0; i < times; ++i) {
+        executed[i] = 0;
+    }
+
+    q.apply(
+      times, [&executed](size_t index) { ++executed[index]; }, grain);
+
+    for (size_t i = 0; i < times; ++i) {
+        MU_ASSERT_EQUAL(executed[i], 1);
+    }
+}
+
+void
+cxx_dispatch_apply_grain(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_apply_grain);
+
+    constexpr size_t kTIMES = 10007;
+
+    xdispatch::queue q =
+      cxx_global_queue(xdispatch::queue_priority::USER_INITIATED);
+
+    // chosen automatically
+    check_apply(q, kTIMES, 0);
+    // not dividing the number of iterations
+    check_apply(q, kTIMES, 64);
+    // a single chunk only
+    check_apply(q, kTIMES, 2 * kTIMES);
+    // nothing at all
+    check_apply(q, 0, 0);
+
+    MU_PASS("Iterations executed");
+    MU_END_TEST;
+}
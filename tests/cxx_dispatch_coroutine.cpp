@@ -0,0 +1,217 @@
+/*
+ * cxx_dispatch_coroutine.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch.h>
+#include "xdispatch/config.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "cxx_tests.h"
+#include "platform_socketpair.h"
+
+/*
+ Checks that coroutines can move between queues, wait for delays,
+ groups and sockets and return values to awaiting coroutines
+ */
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+
+static xdispatch::task<int>
+square_on(xdispatch::queue q, int value)
+{
+    co_await xdispatch::schedule(q);
+    co_return value * value;
+}
+
+static xdispatch::task<>
+fail_on(xdispatch::queue q)
+{
+    co_await xdispatch::schedule(q);
+    throw std::runtime_error("failed");
+}
+
+static xdispatch::task<>
+run_task(std::thread::id main_thread)
+{
+    auto main = cxx_main_queue();
+    auto serial = cxx_create_queue("cxx_dispatch_coroutine_task");
+
+    // results are passed on to the awaiting coroutine
+    int sum = 0;
+    for (int i = 0; i < 10; ++i) {
+        sum += co_await square_on(serial, i);
+    }
+    MU_ASSERT_EQUAL(sum, 285);
+
+    // the coroutine continues on the main thread
+    co_await xdispatch::schedule(main);
+    MU_ASSERT_TRUE(main_thread == std::this_thread::get_id());
+
+    // and only after the delay expired
+    const auto before = std::chrono::steady_clock::now();
+    co_await xdispatch::after(main, std::chrono::milliseconds(100));
+    MU_ASSERT_TRUE(main_thread == std::this_thread::get_id());
+    MU_ASSERT_TRUE(std::chrono::steady_clock::now() - before >=
+                   std::chrono::milliseconds(90));
+
+    // exceptions are rethrown when awaiting
+    bool failed = false;
+    try {
+        co_await fail_on(serial);
+    } catch (const std::runtime_error&) {
+        failed = true;
+    }
+    MU_ASSERT_TRUE(failed);
+
+    // as is awaiting a task holding no coroutine
+    bool rejected = false;
+    try {
+        co_await xdispatch::task<int>();
+    } catch (const std::logic_error&) {
+        rejected = true;
+    }
+    MU_ASSERT_TRUE(rejected);
+
+    // while those escaping a detached task are reported and dropped
+    fail_on(serial).start(serial);
+    co_await xdispatch::after(main, std::chrono::milliseconds(50));
+
+    MU_PASS("Coroutines hop between queues");
+}
+
+static xdispatch::task<>
+run_group()
+{
+    constexpr int kOPERATIONS = 100;
+
+    auto group = cxx_create_group();
+    for (int round = 0; round < 3; ++round) {
+        std::atomic<int> executed(0);
+        for (int i = 0; i < kOPERATIONS; ++i) {
+            group.async(
+              [&executed] {
+                  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                  ++executed;
+              },
+              cxx_global_queue());
+        }
+        co_await xdispatch::when_done(group, cxx_main_queue());
+        MU_ASSERT_EQUAL(executed.load(), kOPERATIONS);
+    }
+
+    // an empty group resumes right away
+    co_await xdispatch::when_done(group, cxx_global_queue());
+    MU_PASS("Group was awaited");
+}
+
+static xdispatch::task<>
+await_ready(xdispatch::socket_notifier notifier)
+{
+    co_await xdispatch::ready(notifier);
+}
+
+static xdispatch::task<>
+run_notifier(xdispatch::socket_notifier notifier, int writer)
+{
+    constexpr int kPACKETS = 5;
+    constexpr int kPACKET = 16;
+
+    std::vector<char> buffer(kPACKET);
+    for (int i = 0; i < kPACKETS; ++i) {
+        MU_ASSERT_EQUAL(kPACKET, write(writer, buffer.data(), kPACKET));
+        co_await xdispatch::ready(notifier);
+        MU_ASSERT_EQUAL(kPACKET,
+                        read(notifier.socket(), buffer.data(), kPACKET));
+    }
+
+    // the handler stays installed once the awaiting coroutine is gone,
+    // the socket becoming ready again must not try to resume it
+    MU_ASSERT_EQUAL(kPACKET, write(writer, buffer.data(), kPACKET));
+    co_await await_ready(notifier);
+    notifier.resume();
+    co_await xdispatch::after(cxx_global_queue(),
+                               std::chrono::milliseconds(20));
+    notifier.suspend();
+    MU_ASSERT_EQUAL(kPACKET, read(notifier.socket(), buffer.data(), kPACKET));
+
+    MU_PASS("Socket was awaited");
+}
+
+#endif // XDISPATCH2_HAVE_COROUTINES
+
+void
+cxx_dispatch_coroutine_task(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_coroutine_task);
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+    run_task(std::this_thread::get_id()).start(cxx_global_queue());
+    cxx_exec();
+
+    MU_FAIL("Should never reach this");
+#else
+    MU_MESSAGE("SKIPPED: Coroutines are not supported by the compiler");
+    MU_PASS("Skipped");
+#endif
+    MU_END_TEST
+}
+
+void
+cxx_dispatch_coroutine_group(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_coroutine_group);
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+    run_group().start(cxx_global_queue());
+    cxx_exec();
+
+    MU_FAIL("Should never reach this");
+#else
+    MU_MESSAGE("SKIPPED: Coroutines are not supported by the compiler");
+    MU_PASS("Skipped");
+#endif
+    MU_END_TEST
+}
+
+void
+cxx_dispatch_coroutine_notifier(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_coroutine_notifier);
+
+#if (defined XDISPATCH2_HAVE_COROUTINES)
+    int fds[2] = { -1 };
+    MU_ASSERT_NOT_EQUAL(platform_socketpair(fds), -1);
+
+    auto notifier = cxx_create_notifier(fds[1], xdispatch::notifier_type::READ);
+    run_notifier(notifier, fds[0]).start(cxx_global_queue());
+    cxx_exec();
+
+    MU_FAIL("Should never reach this");
+#else
+    MU_MESSAGE("SKIPPED: Coroutines are not supported by the compiler");
+    MU_PASS("Skipped");
+#endif
+    MU_END_TEST
+}
@@ -0,0 +1,217 @@
+/*
+ * cxx_dispatch_future.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include <xdispatch/future.h>
+#include "cxx_tests.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ Checks that values and exceptions are passed along chained
+ continuations and that futures can be combined
+ */
+
+void
+cxx_dispatch_future_then(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_future_then);
+
+    const auto main_thread = std::this_thread::get_id();
+    auto serial = cxx_create_queue("cxx_dispatch_future_then");
+
+    // a move-only value is passed along the chain
+    auto chain =
+      xdispatch::async(serial, [] { return std::make_unique<int>(6); })
+        .then(cxx_global_queue(),
+              [](std::unique_ptr<int> value) { return *value * 7; })
+        .then(cxx_global_queue(),
+              [serial](int value) {
+                  // continues once the returned future completed
+                  return xdispatch::async(
+                    serial, [value] { return std::to_string(value); });
+              })
+        .then(cxx_global_queue(),
+              [](const std::string& value) {
+                  MU_ASSERT_TRUE(value == "42");
+                  throw std::runtime_error("failed");
+              })
+        .then(cxx_global_queue(),
+              [] { MU_FAIL("Should not execute after an exception"); });
+
+    // exceptions are passed on to the future returned last
+    bool thrown = false;
+    try {
+        chain.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+
+    // exceptions set explicitly are passed on as well
+    xdispatch::promise<int> failing;
+    auto failed = failing.get_future().then(cxx_global_queue(), [](int) {
+        MU_FAIL("Should not execute after an exception");
+        return 0;
+    });
+    failing.set_exception(
+      std::make_exception_ptr(std::runtime_error("failed")));
+    thrown = false;
+    try {
+        failed.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+
+    // a promise dropped without a value fails its future
+    auto broken = xdispatch::promise<void>().get_future();
+    thrown = false;
+    try {
+        broken.get();
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+
+    // invalid futures can neither be waited for nor continued
+    thrown = false;
+    try {
+        broken.get();
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+    thrown = false;
+    try {
+        broken.then(cxx_global_queue(), [] {});
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+
+    // continuations returning an invalid future fail the one returned
+    auto invalid = xdispatch::async(serial, [] {})
+                     .then(cxx_global_queue(), [] {
+                         return xdispatch::future<int>();
+                     });
+    thrown = false;
+    try {
+        invalid.get();
+    } catch (const std::logic_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+
+    // continuations are chained to completed futures as well
+    xdispatch::promise<int> ready;
+    ready.set_value(1);
+    ready.get_future()
+      .then(cxx_global_queue(), [](int value) { return value + 1; })
+      .then(cxx_main_queue(), [main_thread](int value) {
+          MU_ASSERT_EQUAL(value, 2);
+          MU_ASSERT_TRUE(main_thread == std::this_thread::get_id());
+          MU_PASS("Continuations executed");
+      });
+
+    cxx_exec();
+    MU_END_TEST
+}
+
+void
+cxx_dispatch_future_when(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_future_when);
+
+    constexpr int kFUTURES = 100;
+    auto queue = cxx_global_queue();
+
+    // values are collected in the order the futures were passed
+    std::vector<xdispatch::future<int>> values;
+    for (int i = 0; i < kFUTURES; ++i) {
+        values.push_back(xdispatch::async(queue, [i] { return i; }));
+    }
+    const auto all = xdispatch::when_all(std::move(values)).get();
+    MU_ASSERT_EQUAL(all.size(), kFUTURES);
+    for (int i = 0; i < kFUTURES; ++i) {
+        MU_ASSERT_EQUAL(all[i], i);
+    }
+
+    // the first failure is passed on once all completed
+    std::vector<xdispatch::future<void>> failing;
+    for (int i = 0; i < kFUTURES; ++i) {
+        failing.push_back(xdispatch::async(queue, [i] {
+            if (i == kFUTURES / 2) {
+                throw std::runtime_error("failed");
+            }
+        }));
+    }
+    bool thrown = false;
+    try {
+        xdispatch::when_all(std::move(failing)).get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    MU_ASSERT_TRUE(thrown);
+    MU_ASSERT_TRUE(xdispatch::when_all(std::vector<xdispatch::future<int>>())
+                     .get()
+                     .empty());
+
+    // the first future to complete wins
+    xdispatch::promise<int> never;
+    xdispatch::promise<int> later;
+    std::vector<xdispatch::future<int>> any;
+    any.push_back(never.get_future());
+    any.push_back(later.get_future());
+    auto first = xdispatch::when_any(std::move(any));
+    MU_ASSERT_TRUE(!first.is_ready());
+    later.set_value(42);
+    const auto winner = first.get();
+    MU_ASSERT_EQUAL(winner.first, 1);
+    MU_ASSERT_EQUAL(winner.second, 42);
+    never.set_value(0);
+
+    std::vector<xdispatch::future<void>> done;
+    done.push_back(xdispatch::async(queue, [] {}));
+    MU_ASSERT_EQUAL(xdispatch::when_any(std::move(done)).get(), 0);
+
+    // combined futures may be chained as well
+    std::vector<xdispatch::future<int>> chained;
+    for (int i = 0; i < kFUTURES; ++i) {
+        chained.push_back(xdispatch::async(queue, [i] { return i; }));
+    }
+    xdispatch::when_all(std::move(chained))
+      .then(cxx_main_queue(), [](const std::vector<int>& values) {
+          int sum = 0;
+          for (const auto value : values) {
+              sum += value;
+          }
+          MU_ASSERT_EQUAL(sum, kFUTURES * (kFUTURES - 1) / 2);
+          MU_PASS("Futures combined");
+      });
+
+    cxx_exec();
+    MU_END_TEST
+}
@@ -0,0 +1,78 @@
+/*
+ * cxx_dispatch_group_drain.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*
+ Checks that waits and notifications cover operations added to the
+ group after they were issued for as long as the group did not drain,
+ e.g. operations added from within one of its operations
+ */
+
+static void
+add_nested(xdispatch::group group, std::atomic<int>& done)
+{
+    auto queue = cxx_create_queue("cxx_dispatch_group_drain");
+    group.async(
+      [group, queue, &done] {
+          // added while this operation keeps the group from draining
+          group.async(
+            [&done] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                ++done;
+            },
+            queue);
+          ++done;
+      },
+      queue);
+}
+
+void
+cxx_dispatch_group_drain(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_group_drain);
+
+    static std::atomic<int> done(0);
+
+    auto group = cxx_create_group();
+    add_nested(group, done);
+    MU_ASSERT_TRUE(group.wait());
+    MU_ASSERT_EQUAL(done.load(), 2);
+
+    done = 0;
+    add_nested(group, done);
+    group.notify(
+      [] {
+          MU_ASSERT_EQUAL(done.load(), 2);
+          MU_PASS("Notified once drained");
+      },
+      cxx_main_queue());
+
+    cxx_exec();
+
+    MU_FAIL("Should never reach this");
+    MU_END_TEST
+}
@@ -0,0 +1,97 @@
+/*
+ * cxx_dispatch_group_stress.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ Interleaves millions of async() calls with polling and blocking
+ waits as well as notifications on a single group from several
+ threads, checking that all operations submitted before a wait
+ completed have executed by the time it returns
+ */
+
+void
+cxx_dispatch_group_stress(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_group_stress);
+
+    constexpr int kPRODUCERS = 4;
+    constexpr int kOPERATIONS = 500000;
+    constexpr int kBLOCKING_WAIT = 10000;
+    constexpr int kNOTIFY = 50000;
+
+    auto group = cxx_create_group();
+    auto queue = cxx_global_queue();
+    std::vector<std::atomic<int>> executed(kPRODUCERS);
+    std::atomic<int> notified(0);
+    std::atomic<int> failed_notifications(0);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kPRODUCERS; ++p) {
+        executed[p] = 0;
+        producers.emplace_back([&, p] {
+            auto& done = executed[p];
+            for (int i = 1; i <= kOPERATIONS; ++i) {
+                group.async([&done] { ++done; }, queue);
+
+                if (0 == i % kNOTIFY) {
+                    group.notify(
+                      [&done, &notified, &failed_notifications, i] {
+                          if (done < i) {
+                              ++failed_notifications;
+                          }
+                          ++notified;
+                      },
+                      queue);
+                }
+                if (0 == i % kBLOCKING_WAIT) {
+                    MU_ASSERT_TRUE(group.wait());
+                    MU_ASSERT_EQUAL(done.load(), i);
+                } else if (group.wait(std::chrono::milliseconds(0))) {
+                    MU_ASSERT_EQUAL(done.load(), i);
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    MU_ASSERT_TRUE(group.wait());
+    for (const auto& done : executed) {
+        MU_ASSERT_EQUAL(done.load(), kOPERATIONS);
+    }
+
+    // notifications are queued once the operations completed
+    constexpr int kNOTIFICATIONS = kPRODUCERS * kOPERATIONS / kNOTIFY;
+    while (notified < kNOTIFICATIONS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_EQUAL(failed_notifications.load(), 0);
+
+    MU_PASS("Group stayed consistent");
+    MU_END_TEST;
+}
@@ -24,6 +24,7 @@
 #include "cxx_tests.h"
 
 #include <atomic>
+#include <thread>
 
 #define RUN_TIMES 20
 
@@ -78,3 +79,25 @@ cxx_dispatch_mainqueue(void* data)
     cxx_exec();
     MU_END_TEST;
 }
+
+void
+cxx_dispatch_mainqueue_apply(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_mainqueue_apply);
+
+    // applying from a worker must not run the iterations on the worker
+    // even though the main queue is idle
+    const auto main_thread = std::this_thread::get_id();
+    cxx_global_queue().async([main_thread] {
+        MU_ASSERT_TRUE(std::this_thread::get_id() != main_thread);
+        auto* worker = new std::atomic<int>(0);
+        cxx_main_queue().apply(RUN_TIMES, [worker, main_thread](size_t) {
+            MU_ASSERT_TRUE(std::this_thread::get_id() == main_thread);
+            (*worker)++;
+        });
+        cxx_main_queue().async(std::make_shared<cleanup>(worker));
+    });
+
+    cxx_exec();
+    MU_END_TEST;
+}
@@ -0,0 +1,107 @@
+/*
+ * cxx_dispatch_operation_pooling.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include <xdispatch/barrier_operation.h>
+#include "cxx_tests.h"
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+/*
+ Checks that operations stop allocating memory once enough
+ operations have been released for reuse and that the free
+ lists do not grow without bounds
+ */
+
+static uint64_t
+run_round(const xdispatch::queue& queue, int operations)
+{
+    const auto before = xdispatch::operation_allocations();
+
+    std::atomic<int> executed(0);
+    // too big to be stored inline
+    std::array<char, 2 * xdispatch::unique_operation::inline_size> padding{};
+    for (int i = 0; i < operations; ++i) {
+        queue.async([&executed, padding] { ++executed; });
+        queue.async(xdispatch::make_operation([&executed] { ++executed; }));
+    }
+    auto barrier = std::make_shared<xdispatch::barrier_operation>();
+    queue.async(barrier);
+    MU_ASSERT_TRUE(barrier->wait());
+    MU_ASSERT_EQUAL(executed, 2 * operations);
+
+    const auto after = xdispatch::operation_allocations();
+    MU_ASSERT_TRUE(after.allocations + after.recycled >=
+                   before.allocations + before.recycled + 2 * operations);
+    return after.allocations - before.allocations;
+}
+
+void
+cxx_dispatch_operation_pooling(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_operation_pooling);
+
+    constexpr int kOPERATIONS = 1000;
+    constexpr int kMAX_ROUNDS = 10;
+    xdispatch::queue queue = cxx_create_queue("cxx_dispatch_operation_pooling");
+
+    const bool pooling = xdispatch::operation_pooling();
+    xdispatch::operation_pooling(true);
+    uint64_t allocations = 0;
+    for (int round = 0; round < kMAX_ROUNDS; ++round) {
+        allocations = run_round(queue, kOPERATIONS);
+        MU_MESSAGE("Round %i: %i allocations", round, int(allocations));
+        if (0 == allocations) {
+            break;
+        }
+    }
+    // other threads may still be allocating for themselves at times,
+    // e.g. a worker spawned in the middle of the round
+    MU_ASSERT_LESS_THAN(allocations, uint64_t(kOPERATIONS / 10));
+
+    // memory released beyond the high-water mark is not kept
+    constexpr int kBLOCKS = 20000;
+    constexpr size_t kBLOCK_SIZE = 48;
+    constexpr int kMAX_CACHED = 1024 * 1024 / (kBLOCK_SIZE + 16);
+    const auto before = xdispatch::operation_allocations();
+    std::vector<void*> blocks;
+    for (int i = 0; i < kBLOCKS; ++i) {
+        blocks.push_back(xdispatch::allocate_operation(kBLOCK_SIZE));
+    }
+    for (auto* block : blocks) {
+        xdispatch::deallocate_operation(block, kBLOCK_SIZE);
+    }
+    const auto after = xdispatch::operation_allocations();
+    MU_MESSAGE("Trimmed %i blocks", int(after.trimmed - before.trimmed));
+    MU_ASSERT_GREATER_THAN_EQUAL(after.trimmed - before.trimmed,
+                                 uint64_t(kBLOCKS - kMAX_CACHED));
+
+    // every operation allocates when disabled
+    xdispatch::operation_pooling(false);
+    allocations = run_round(queue, kOPERATIONS);
+    xdispatch::operation_pooling(pooling);
+    MU_ASSERT_TRUE(allocations >= 2 * kOPERATIONS);
+
+    MU_PASS("Operations recycled");
+    MU_END_TEST;
+}
@@ -0,0 +1,177 @@
+/*
+ * cxx_dispatch_queue_bulk.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+/*
+ Checks that operations queued in bulk are all executed and
+ keep their order on a serial queue
+ */
+
+static constexpr unsigned kBULK = 100;
+
+// yields copies of a function from a budget shared by all its copies
+// so that the range can only be traversed once
+class single_pass_iterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::function<void()>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = value_type;
+
+    single_pass_iterator()
+      : m_remaining(nullptr)
+      , m_yielded(nullptr)
+      , m_function()
+    {}
+
+    single_pass_iterator(unsigned* remaining,
+                         unsigned* yielded,
+                         value_type function)
+      : m_remaining(remaining)
+      , m_yielded(yielded)
+      , m_function(std::move(function))
+    {}
+
+    value_type operator*() const
+    {
+        ++(*m_yielded);
+        return m_function;
+    }
+
+    single_pass_iterator& operator++()
+    {
+        --(*m_remaining);
+        return *this;
+    }
+
+    bool operator==(const single_pass_iterator& other) const
+    {
+        return at_end() == other.at_end();
+    }
+
+    bool operator!=(const single_pass_iterator& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    bool at_end() const { return !m_remaining || 0 == *m_remaining; }
+
+    unsigned* m_remaining;
+    unsigned* m_yielded;
+    value_type m_function;
+};
+
+void
+cxx_dispatch_queue_bulk(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_queue_bulk);
+
+    auto* executed = new std::atomic<unsigned>(0);
+    auto* ordered = new std::atomic<unsigned>(0);
+    const auto done = [executed, ordered] {
+        if (7 * kBULK == ++(*executed)) {
+            cxx_main_queue().async([executed, ordered] {
+                MU_ASSERT_EQUAL(*ordered, kBULK);
+                delete executed;
+                delete ordered;
+                MU_PASS("Operations executed");
+            });
+        }
+    };
+
+    xdispatch::queue serial = cxx_create_queue("cxx_dispatch_queue_bulk");
+    xdispatch::queue global =
+      cxx_global_queue(xdispatch::queue_priority::DEFAULT);
+
+    // move-only operations are moved from the range
+    std::vector<xdispatch::unique_operation> unique;
+    for (unsigned i = 0; i < kBULK; ++i) {
+        unique.emplace_back([i, ordered, done] {
+            MU_ASSERT_EQUAL(ordered->load(), i);
+            ordered->store(i + 1);
+            done();
+        });
+    }
+    serial.async_bulk(unique.begin(), unique.end());
+    for (const auto& op : unique) {
+        MU_ASSERT_TRUE(!op);
+    }
+
+    // shared operations and functions are copied
+    std::vector<xdispatch::operation_ptr> shared(
+      kBULK, xdispatch::make_operation(done));
+    global.async_bulk(shared.begin(), shared.end());
+    serial.async_bulk(shared.begin(), shared.end());
+    MU_ASSERT_TRUE(shared.front() && shared.back());
+
+    const std::vector<std::function<void()>> functions(kBULK / 2, done);
+    global.async_bulk(functions.begin(), functions.end());
+    global.async_bulk(functions.cbegin(), functions.cend());
+
+    // moved when the iterator yields rvalues, including move-only functions
+    std::vector<xdispatch::unique_operation> moved;
+    for (unsigned i = 0; i < kBULK; ++i) {
+        moved.emplace_back(done);
+    }
+    global.async_bulk(std::make_move_iterator(moved.begin()),
+                      std::make_move_iterator(moved.end()));
+    for (const auto& op : moved) {
+        MU_ASSERT_TRUE(!op);
+    }
+
+    const auto move_only = [done] {
+        return [owned = std::unique_ptr<int>(new int(42)), done] {
+            MU_ASSERT_EQUAL(*owned, 42);
+            done();
+        };
+    };
+    std::vector<decltype(move_only())> lambdas;
+    for (unsigned i = 0; i < kBULK; ++i) {
+        lambdas.push_back(move_only());
+    }
+    global.async_bulk(std::make_move_iterator(lambdas.begin()),
+                      std::make_move_iterator(lambdas.end()));
+
+    // single-pass ranges are traversed once only
+    unsigned remaining = kBULK;
+    unsigned yielded = 0;
+    global.async_bulk(single_pass_iterator(&remaining, &yielded, done),
+                      single_pass_iterator());
+    MU_ASSERT_EQUAL(yielded, kBULK);
+
+    // an empty range is fine as well
+    global.async_bulk(unique.end(), unique.end());
+
+    cxx_exec();
+    MU_END_TEST;
+}
@@ -0,0 +1,77 @@
+/*
+ * cxx_dispatch_serialqueue_producers.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ Checks that a serial queue keeps the order of operations
+ queued by each of several concurrent producers
+ */
+
+void
+cxx_dispatch_serialqueue_producers(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_serialqueue_producers);
+
+    constexpr int kPRODUCERS = 8;
+    constexpr int kJOBS = 20000;
+
+    struct state
+    {
+        std::vector<int> last_seen = std::vector<int>(kPRODUCERS, -1);
+        std::atomic<bool> active{ false };
+        int executed = 0;
+    };
+    auto* s = new state;
+    xdispatch::queue q = cxx_create_queue("cxx_dispatch_serialqueue_producers");
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kPRODUCERS; ++p) {
+        producers.emplace_back([p, q, s] {
+            for (int job = 0; job < kJOBS; ++job) {
+                q.async([p, job, s] {
+                    MU_ASSERT_TRUE(!s->active.exchange(true));
+                    MU_ASSERT_EQUAL(s->last_seen[p] + 1, job);
+                    s->last_seen[p] = job;
+                    ++s->executed;
+                    s->active = false;
+                });
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    q.async([s] {
+        MU_ASSERT_EQUAL(s->executed, kPRODUCERS * kJOBS);
+        delete s;
+        MU_PASS("Operations were executed in correct order");
+    });
+
+    cxx_exec();
+    MU_END_TEST;
+}
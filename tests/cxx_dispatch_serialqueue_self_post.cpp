@@ -0,0 +1,97 @@
+/*
+ * cxx_dispatch_serialqueue_self_post.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+/*
+ Checks that operations queued by an operation onto its own serial
+ queue keep their order relative to operations queued by other threads
+ */
+
+void
+cxx_dispatch_serialqueue_self_post(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_serialqueue_self_post);
+
+    constexpr int kSTEPS = 999;
+
+    struct state
+    {
+        // steps are logged as positive, foreign operations as negative
+        std::vector<int> log;
+        std::function<void(int)> step;
+    };
+    auto* s = new state;
+    xdispatch::queue q = cxx_create_queue("cxx_dispatch_serialqueue_self_post");
+
+    const auto foreign = [q, s](int step) {
+        std::thread([q, s, step] {
+            q.async([s, step] { s->log.push_back(-step); });
+        }).join();
+    };
+    s->step = [q, s, foreign](int step) {
+        s->log.push_back(step);
+        if (step == kSTEPS) {
+            q.async([s] {
+                const auto position = [s](int entry) {
+                    return static_cast<int>(
+                      std::find(s->log.begin(), s->log.end(), entry) -
+                      s->log.begin());
+                };
+                for (int step = 1; step < kSTEPS; ++step) {
+                    MU_ASSERT_LESS_THAN(position(step), position(step + 1));
+                    if (1 == step % 3) {
+                        // queued before the next step
+                        MU_ASSERT_LESS_THAN(position(-step),
+                                            position(step + 1));
+                    } else if (2 == step % 3) {
+                        // queued after the next step
+                        MU_ASSERT_LESS_THAN(position(step + 1),
+                                            position(-step));
+                    }
+                }
+                MU_ASSERT_EQUAL(static_cast<int>(s->log.size()),
+                                kSTEPS + 2 * kSTEPS / 3);
+                delete s;
+                MU_PASS("Operations were executed in correct order");
+            });
+            return;
+        }
+
+        if (1 == step % 3) {
+            foreign(step);
+        }
+        q.async([s, step] { s->step(step + 1); });
+        if (2 == step % 3) {
+            foreign(step);
+        }
+    };
+    q.async([s] { s->step(1); });
+
+    cxx_exec();
+    MU_END_TEST;
+}
@@ -175,12 +175,17 @@ cxx_dispatch_after(const xdispatch::queue& queue)
               MU_PASS("Done");
           });
       });
-    queue.async([&async_complete, &after_complete, counter] {
-        MU_ASSERT_TRUE(!async_complete);
-        MU_ASSERT_TRUE(!after_complete);
-        MU_ASSERT_EQUAL(s_scope_count, 3);
-        async_complete = true;
-    });
+    // create the operation upfront so that no temporary copy of the
+    // counter is alive anymore once the operation gets executed
+    auto async_op =
+      xdispatch::make_operation([&async_complete, &after_complete, counter] {
+          MU_ASSERT_TRUE(!async_complete);
+          MU_ASSERT_TRUE(!after_complete);
+          MU_ASSERT_EQUAL(s_scope_count, 3);
+          async_complete = true;
+      });
+    queue.async(async_op);
+    async_op.reset();
     elapsed.start();
 
     cxx_exec();
@@ -281,3 +286,72 @@ cxx_dispatch_timer_cancel(void* data)
 
     MU_PASS("");
 }
+
+void
+cxx_dispatch_after_many(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_after_many);
+
+    // a lot of pending delayed operations must neither exhaust
+    // any resources nor fire before their respective delay
+    static constexpr int kOperations = 5000;
+    static constexpr int kMaxDelayMs = 100;
+    std::atomic_int fired{ 0 };
+    std::atomic_int too_early{ 0 };
+    auto barrier = std::make_shared<xdispatch::barrier_operation>();
+    auto queue = cxx_global_queue();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kOperations; ++i) {
+        const auto delay = std::chrono::milliseconds(i % kMaxDelayMs);
+        queue.after(delay, [&, start, delay, barrier] {
+            if (std::chrono::steady_clock::now() - start < delay) {
+                ++too_early;
+            }
+            if (++fired == kOperations) {
+                (*barrier)();
+            }
+        });
+    }
+    MU_ASSERT_TRUE(barrier->wait(std::chrono::seconds(10)));
+    MU_ASSERT_EQUAL(too_early.load(), 0);
+    MU_ASSERT_EQUAL(fired.load(), kOperations);
+
+    MU_PASS("");
+}
+
+void
+cxx_dispatch_timer_latency(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_timer_latency);
+
+    // coarse timers may be shifted to fire together with others
+    // but must still fire once per interval on average
+    static constexpr int kTicks = 10;
+    const std::chrono::milliseconds kInterval(100);
+    std::atomic_int ticks{ 0 };
+    auto barrier = std::make_shared<xdispatch::barrier_operation>();
+
+    auto timer = cxx_create_timer();
+    timer.interval(kInterval);
+    timer.latency(xdispatch::timer_precision::COARSE);
+    timer.handler([&ticks, barrier] {
+        if (++ticks == kTicks) {
+            (*barrier)();
+        }
+    });
+
+    Stopwatch elapsed;
+    elapsed.start();
+    timer.resume();
+    MU_ASSERT_TRUE(barrier->wait(kInterval * kTicks * 2));
+    timer.cancel();
+
+    const auto total =
+      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed.elapsed());
+    MU_ASSERT_LESS_THAN(total.count(), (kInterval * (kTicks + 1)).count());
+    MU_ASSERT_GREATER_THAN(total.count(),
+                           LowerBound(kInterval * (kTicks - 1)).count());
+
+    MU_PASS("");
+}
@@ -0,0 +1,133 @@
+/*
+ * cxx_dispatch_unique_operation.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <xdispatch/dispatch>
+#include "cxx_tests.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/*
+ Checks that move-only functions of any size can be queued
+ */
+
+// refers to itself so that copying its bytes would break it
+struct self_referencing
+{
+    explicit self_referencing(std::function<void()> done)
+      : m_self(this)
+      , m_done(std::move(done))
+    {}
+
+    self_referencing(self_referencing&& other) noexcept
+      : m_self(this)
+      , m_done(std::move(other.m_done))
+    {}
+
+    void operator()() const
+    {
+        MU_ASSERT_TRUE(this == m_self);
+        m_done();
+    }
+
+    const self_referencing* m_self;
+    std::function<void()> m_done;
+};
+
+// requires more alignment than any allocation guarantees by default
+struct alignas(64) over_aligned
+{
+    bool aligned() const
+    {
+        return 0 == reinterpret_cast<uintptr_t>(this) % alignof(over_aligned);
+    }
+
+    std::array<float, 16> m_values;
+};
+
+void
+cxx_dispatch_unique_operation(void* data)
+{
+    CXX_BEGIN_BACKEND_TEST(cxx_dispatch_unique_operation);
+
+    constexpr int kOPERATIONS = 6;
+    auto* executed = new std::atomic<int>(0);
+    const auto done = [executed] {
+        if (kOPERATIONS == ++(*executed)) {
+            cxx_main_queue().async([executed] {
+                delete executed;
+                MU_PASS("Operations executed");
+            });
+        }
+    };
+
+    xdispatch::queue serial = cxx_create_queue("cxx_dispatch_unique_operation");
+    xdispatch::queue global =
+      cxx_global_queue(xdispatch::queue_priority::DEFAULT);
+
+    // small enough to be stored inline
+    std::unique_ptr<int> small(new int(42));
+    serial.async([small = std::move(small), done] {
+        MU_ASSERT_EQUAL(*small, 42);
+        done();
+    });
+
+    // too big to be stored inline
+    std::unique_ptr<int> big(new int(43));
+    std::array<char, 2 * xdispatch::unique_operation::inline_size> padding{};
+    padding.back() = 1;
+    global.async([big = std::move(big), padding, done] {
+        MU_ASSERT_EQUAL(*big, 43);
+        MU_ASSERT_EQUAL(padding.back(), 1);
+        done();
+    });
+
+    // stored inline but needs to be moved by its constructor
+    static_assert(sizeof(self_referencing) <=
+                    xdispatch::unique_operation::inline_size,
+                  "expected to be stored inline");
+    xdispatch::unique_operation relocated{ self_referencing(done) };
+    xdispatch::unique_operation moved(std::move(relocated));
+    serial.async(std::move(moved));
+
+    // over-aligned functions are allocated with their alignment
+    // no matter whether stored by a unique or a shared operation
+    const over_aligned values{};
+    serial.async([values, done] {
+        MU_ASSERT_TRUE(values.aligned());
+        done();
+    });
+    serial.async(xdispatch::make_operation([values, done] {
+        MU_ASSERT_TRUE(values.aligned());
+        done();
+    }));
+
+    // a shared operation wrapped for compatibility
+    xdispatch::unique_operation wrapped(xdispatch::make_operation(done));
+    MU_ASSERT_TRUE(static_cast<bool>(wrapped));
+    serial.async(std::move(wrapped));
+
+    cxx_exec();
+    MU_END_TEST;
+}
@@ -30,6 +30,8 @@ cxx_dispatch_group(void*);
 void
 cxx_dispatch_mainqueue(void*);
 void
+cxx_dispatch_mainqueue_apply(void*);
+void
 cxx_dispatch_timer_global(void*);
 void
 cxx_dispatch_timer_serial(void*);
@@ -46,6 +48,10 @@ cxx_dispatch_after_serial(void*);
 void
 cxx_dispatch_after_main(void*);
 void
+cxx_dispatch_after_many(void*);
+void
+cxx_dispatch_timer_latency(void*);
+void
 cxx_dispatch_notifier_read(void*);
 void
 cxx_dispatch_notifier_write(void*);
@@ -60,10 +66,36 @@ cxx_dispatch_cascade_lambda(void*);
 void
 cxx_dispatch_group_lambda(void*);
 void
+cxx_dispatch_group_stress(void*);
+void
+cxx_dispatch_group_drain(void*);
+void
 cxx_dispatch_queue_lambda(void*);
 void
+cxx_dispatch_queue_bulk(void*);
+void
+cxx_dispatch_apply_grain(void*);
+void
 cxx_dispatch_serialqueue_lambda(void*);
 void
+cxx_dispatch_serialqueue_producers(void*);
+void
+cxx_dispatch_serialqueue_self_post(void*);
+void
+cxx_dispatch_coroutine_task(void*);
+void
+cxx_dispatch_coroutine_group(void*);
+void
+cxx_dispatch_coroutine_notifier(void*);
+void
+cxx_dispatch_future_then(void*);
+void
+cxx_dispatch_future_when(void*);
+void
+cxx_dispatch_unique_operation(void*);
+void
+cxx_dispatch_operation_pooling(void*);
+void
 cxx_free_lambda(void*);
 void
 cxx_dispatch_priority_custom(void*);
@@ -74,8 +106,32 @@ cxx_benchmark_serial_queue(void*);
 void
 cxx_benchmark_global_queue(void*);
 void
+cxx_benchmark_serial_queue_lambda(void*);
+void
+cxx_benchmark_global_queue_lambda(void*);
+void
+cxx_benchmark_serial_queue_bulk(void*);
+void
+cxx_benchmark_global_queue_bulk(void*);
+void
+cxx_benchmark_global_queue_producers(void*);
+void
+cxx_benchmark_serial_queue_self_post(void*);
+void
+cxx_benchmark_coroutine_schedule(void*);
+void
+cxx_benchmark_future_then(void*);
+void
 cxx_benchmark_group(void*);
 void
+cxx_benchmark_group_concurrent(void*);
+void
+cxx_benchmark_fork_join(void*);
+void
+cxx_benchmark_apply(void*);
+void
+cxx_benchmark_apply_nested(void*);
+void
 cxx_waitable_queue(void*);
 
 void
@@ -83,6 +139,7 @@ register_cxx_tests(const char* name, xdispatch::ibackend* backend)
 {
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_group, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_mainqueue, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_mainqueue_apply, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_timer_main, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_timer_global, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_timer_serial, backend);
@@ -91,6 +148,8 @@ register_cxx_tests(const char* name, xdispatch::ibackend* backend)
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_after_main, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_after_global, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_after_serial, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_after_many, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_timer_latency, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_notifier_read, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_notifier_write, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_notifier_suspend, backend);
@@ -98,14 +157,44 @@ register_cxx_tests(const char* name, xdispatch::ibackend* backend)
     //    MU_REGISTER_TEST_INSTANCE( name, cxx_dispatch_fibo, backend );
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_cascade_lambda, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_group_lambda, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_group_stress, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_group_drain, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_queue_lambda, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_queue_bulk, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_apply_grain, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_serialqueue_lambda, backend);
+    MU_REGISTER_TEST_INSTANCE(
+      name, cxx_dispatch_serialqueue_producers, backend);
+    MU_REGISTER_TEST_INSTANCE(
+      name, cxx_dispatch_serialqueue_self_post, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_coroutine_task, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_coroutine_group, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_coroutine_notifier, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_future_then, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_future_when, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_unique_operation, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_operation_pooling, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_free_lambda, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_priority_custom, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_dispatch_priority_global, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_serial_queue, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_global_queue, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_serial_queue_lambda, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_global_queue_lambda, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_serial_queue_bulk, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_global_queue_bulk, backend);
+    MU_REGISTER_TEST_INSTANCE(
+      name, cxx_benchmark_global_queue_producers, backend);
+    MU_REGISTER_TEST_INSTANCE(
+      name, cxx_benchmark_serial_queue_self_post, backend);
+    MU_REGISTER_TEST_INSTANCE(
+      name, cxx_benchmark_coroutine_schedule, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_future_then, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_group, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_group_concurrent, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_fork_join, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_apply, backend);
+    MU_REGISTER_TEST_INSTANCE(name, cxx_benchmark_apply_nested, backend);
     MU_REGISTER_TEST_INSTANCE(name, cxx_waitable_queue, backend);
 }
 
@@ -30,6 +30,7 @@ XDISPATCH_DECLARE_BACKEND(libdispatch)
 #endif
 #if (defined BUILD_XDISPATCH2_BACKEND_NAIVE)
 XDISPATCH_DECLARE_BACKEND(naive)
+    #include "naive_tests.h"
 #endif
 #if (defined BUILD_XDISPATCH2_BACKEND_QT5)
     #include <QtCore/QCoreApplication>
@@ -66,6 +67,7 @@ main(int argc, char* argv[])
 
 #if (defined BUILD_XDISPATCH2_BACKEND_NAIVE)
     register_cxx_tests("naive", naive_backend_get_static_instance());
+    register_naive_tests();
 #endif
 
 #if (defined BUILD_XDISPATCH2_BACKEND_QT5)
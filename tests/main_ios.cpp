@@ -29,6 +29,7 @@
 #endif
 #if (defined BUILD_XDISPATCH2_BACKEND_NAIVE)
     #include "../src/naive/naive_backend_internal.h"
+    #include "naive_tests.h"
 #endif
 #if (defined BUILD_XDISPATCH2_BACKEND_QT5)
     #include <QtCore/QCoreApplication>
@@ -65,6 +66,7 @@ int run_dispatch_tests(int argc, char* argv[], MU_messageHandler handler) {
 #if (defined BUILD_XDISPATCH2_BACKEND_NAIVE)
     static xdispatch::naive::backend s_naive;
     register_cxx_tests( "naive", &s_naive );
+    register_naive_tests();
 #endif
 
 #if (defined BUILD_XDISPATCH2_BACKEND_QT5)
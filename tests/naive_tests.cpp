@@ -0,0 +1,1089 @@
+/*
+ * naive_tests.cpp
+ *
+ * Copyright (c) 2011 - 2024 Marius Zwicker
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "naive_tests.h"
+#include "platform_socketpair.h"
+#include "stopwatch.h"
+
+#include <xdispatch/dispatch>
+#include <xdispatch/backend_naive.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if (defined XDISPATCH2_HAVE_PTHREAD_SETAFFINITY_NP)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+#if (defined XDISPATCH2_HAVE_SOCKETPAIR)
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+#endif
+
+void
+naive_threadpool_weights(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_weights);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    const xdispatch::naive::threadpool::bucket_weights weights = { 4, 2, 1, 1 };
+    pool->weights(weights);
+    MU_ASSERT_TRUE(weights == pool->weights());
+    pool->aging(std::chrono::milliseconds(10));
+    MU_ASSERT_EQUAL(pool->aging().count(), 10);
+
+    auto interactive = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_weights",
+      pool,
+      xdispatch::queue_priority::USER_INTERACTIVE);
+    auto background = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_weights",
+      pool,
+      xdispatch::queue_priority::BACKGROUND);
+
+    // flood the pool with high priority work and make sure the background
+    // operations queued last still complete while high priority work is
+    // still pending
+    constexpr int kINTERACTIVE = 2000;
+    constexpr int kBACKGROUND = 20;
+    std::atomic<int> interactive_done(0);
+    std::atomic<int> background_done(0);
+    std::atomic<int> interactive_when_background_done(-1);
+    for (int i = 0; i < kINTERACTIVE; ++i) {
+        interactive.async([&interactive_done] {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            ++interactive_done;
+        });
+    }
+    for (int i = 0; i < kBACKGROUND; ++i) {
+        background.async([&] {
+            if (kBACKGROUND == ++background_done) {
+                interactive_when_background_done = interactive_done.load();
+            }
+        });
+    }
+
+    while (interactive_done < kINTERACTIVE || background_done < kBACKGROUND) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    MU_MESSAGE("Background drained after %i interactive operations",
+               interactive_when_background_done.load());
+    MU_ASSERT_GREATER_THAN_EQUAL(interactive_when_background_done.load(), 0);
+    MU_ASSERT_LESS_THAN(interactive_when_background_done.load(),
+                        kINTERACTIVE / 2);
+
+    const auto statistics = pool->statistics();
+    const auto& stats =
+      statistics[xdispatch::naive::threadpool::bucket_USER_INTERACTIVE];
+    MU_ASSERT_GREATER_THAN(stats.samples, 0);
+    MU_ASSERT_GREATER_THAN_EQUAL(stats.max_wait.count(),
+                                 stats.average_wait.count());
+    MU_MESSAGE("Interactive operations waited %i usec on average",
+               static_cast<int>(stats.average_wait.count() / 1000));
+
+    MU_PASS("Background operations were not starved");
+    MU_END_TEST;
+}
+
+void
+naive_threadpool_weights_zero(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_weights_zero);
+
+    xdispatch::naive::threadpool_config config;
+    config.max_threads = 1;
+    auto pool = std::make_shared<xdispatch::naive::threadpool>(config);
+    pool->weights({ 0, 1, 1, 1 });
+    pool->aging(std::chrono::seconds(10));
+
+    auto interactive = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_weights_zero",
+      pool,
+      xdispatch::queue_priority::USER_INTERACTIVE);
+    auto background = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_weights_zero",
+      pool,
+      xdispatch::queue_priority::BACKGROUND);
+
+    // keep the only worker busy until everything got queued
+    std::atomic<bool> blocked(true);
+    std::atomic<bool> started(false);
+    background.async([&] {
+        started = true;
+        while (blocked) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+    while (!started) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // the interactive bucket has no weight so it may only be served
+    // once the background bucket ran empty despite its higher priority
+    constexpr int kOPERATIONS = 50;
+    std::atomic<int> interactive_done(0);
+    std::atomic<int> background_done(0);
+    std::atomic<int> background_when_interactive_started(-1);
+    for (int i = 0; i < kOPERATIONS; ++i) {
+        interactive.async([&] {
+            if (0 == interactive_done++) {
+                background_when_interactive_started = background_done.load();
+            }
+        });
+    }
+    for (int i = 0; i < kOPERATIONS; ++i) {
+        background.async([&] { ++background_done; });
+    }
+    blocked = false;
+
+    while (interactive_done < kOPERATIONS || background_done < kOPERATIONS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_EQUAL(background_when_interactive_started.load(), kOPERATIONS);
+
+    MU_PASS("Zero weight bucket served last");
+    MU_END_TEST;
+}
+
+void
+naive_threadpool_wake(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_wake);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    auto queue = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_wake", pool, xdispatch::queue_priority::DEFAULT);
+
+    // have a number of workers spawned which go idle afterwards
+    constexpr int kWORKERS = 4;
+    std::atomic<int> spawned(0);
+    for (int i = 0; i < kWORKERS; ++i) {
+        queue.async([&spawned] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            ++spawned;
+        });
+    }
+    while (spawned < kWORKERS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // operations trickling in one by one should always be served by
+    // the worker which went idle last, i.e. the one which ran before
+    constexpr int kTRICKLE = 20;
+    std::vector<std::thread::id> ids;
+    for (int i = 0; i < kTRICKLE; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::atomic<bool> done(false);
+        queue.async([&ids, &done] {
+            ids.push_back(std::this_thread::get_id());
+            done = true;
+        });
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    for (const auto& id : ids) {
+        MU_ASSERT_TRUE(id == ids.back());
+    }
+
+    const auto stats = pool->wake_statistics();
+    MU_ASSERT_GREATER_THAN(stats.samples, 0);
+    MU_ASSERT_GREATER_THAN_EQUAL(stats.max_latency.count(),
+                                 stats.average_latency.count());
+    MU_MESSAGE("Idle workers took %i usec to run on average",
+               static_cast<int>(stats.average_latency.count() / 1000));
+
+    MU_PASS("Woke the most recently active worker");
+    MU_END_TEST;
+}
+
+void
+naive_threadpool_park_policy(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_park_policy);
+
+    xdispatch::naive::threadpool_park_policy policy;
+    policy.spins = 0;
+    policy.park_timeout = std::chrono::milliseconds(10);
+
+    // without warm threads the worker ends and a new one gets
+    // spawned, with warm threads the same worker has to be woken
+    for (unsigned warm = 0; warm < 2; ++warm) {
+        policy.min_warm_threads = warm;
+        auto pool = std::make_shared<xdispatch::naive::threadpool>(
+          false /* work_stealing */, policy);
+        MU_ASSERT_EQUAL(pool->park_policy().min_warm_threads, warm);
+        MU_ASSERT_EQUAL(pool->park_policy().park_timeout.count(), 10);
+        auto queue = xdispatch::naive::create_parallel_queue(
+          "naive_threadpool_park_policy",
+          pool,
+          xdispatch::queue_priority::DEFAULT);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::atomic<bool> done(false);
+        queue.async([&done] { done = true; });
+        while (!done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        MU_ASSERT_EQUAL(pool->wake_statistics().samples > 0, warm > 0);
+    }
+
+    MU_PASS("Warm threads were kept");
+    MU_END_TEST;
+}
+
+void
+naive_benchmark_park_policy(void*)
+{
+    MU_BEGIN_TEST(naive_benchmark_park_policy);
+
+    struct setting
+    {
+        const char* label;
+        unsigned spins;
+        bool adaptive;
+        unsigned yields;
+    };
+    const setting settings[] = {
+        { "park", 0, false, 0 },
+        { "yield", 0, false, 100 },
+        { "default", 1000, false, 0 },
+        { "spin", 100000, false, 0 },
+        { "adaptive", 100000, true, 0 },
+    };
+
+    // operations trickle in with gaps so that workers go idle in between,
+    // how fast they pick up the next one is traded for the processor
+    // time burnt while waiting for it
+    constexpr int kOPERATIONS = 2000;
+    const auto kGAP = std::chrono::microseconds(50);
+    using clock = std::chrono::steady_clock;
+
+    for (const auto& s : settings) {
+        xdispatch::naive::threadpool_park_policy policy;
+        policy.spins = s.spins;
+        policy.adaptive = s.adaptive;
+        policy.yields = s.yields;
+        auto pool = std::make_shared<xdispatch::naive::threadpool>(
+          false /* work_stealing */, policy);
+        auto queue = xdispatch::naive::create_parallel_queue(
+          "naive_benchmark_park_policy",
+          pool,
+          xdispatch::queue_priority::DEFAULT);
+
+        std::vector<clock::duration> latencies(kOPERATIONS);
+        std::atomic<int> done(0);
+        const auto cpu_start = std::clock();
+        const auto wall_start = clock::now();
+        for (int i = 0; i < kOPERATIONS; ++i) {
+            std::this_thread::sleep_for(kGAP);
+            const auto posted = clock::now();
+            queue.async([&latencies, &done, i, posted] {
+                latencies[i] = clock::now() - posted;
+                ++done;
+            });
+        }
+        while (done < kOPERATIONS) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const auto wall = clock::now() - wall_start;
+        const auto cpu = std::clock() - cpu_start;
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto usec = [](clock::duration d) {
+            return static_cast<int>(
+              std::chrono::duration_cast<std::chrono::microseconds>(d)
+                .count());
+        };
+        const auto cpu_usec = static_cast<double>(cpu) * 1000000 /
+                              static_cast<double>(CLOCKS_PER_SEC);
+        MU_MESSAGE("%-8s p50 %i usec, p99 %i usec, %i%% cpu",
+                   s.label,
+                   usec(latencies[kOPERATIONS / 2]),
+                   usec(latencies[kOPERATIONS * 99 / 100]),
+                   static_cast<int>(100 * cpu_usec / usec(wall)));
+    }
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+naive_benchmark_execute_latency(void*)
+{
+    MU_BEGIN_TEST(naive_benchmark_execute_latency);
+
+    // each round starts with a pool without any threads so that
+    // the operations submitted in a burst make the pool spawn some
+    constexpr int kROUNDS = 20;
+    constexpr int kBURST = 64;
+    std::vector<std::chrono::nanoseconds> latencies;
+    latencies.reserve(kROUNDS * kBURST);
+    for (int round = 0; round < kROUNDS; ++round) {
+        xdispatch::naive::threadpool_config config;
+        config.max_threads = 16;
+        auto pool = std::make_shared<xdispatch::naive::threadpool>(config);
+        std::atomic<int> done(0);
+        for (int i = 0; i < kBURST; ++i) {
+            const auto start = std::chrono::steady_clock::now();
+            pool->execute_unique(xdispatch::unique_operation([&done] {
+                                     std::this_thread::sleep_for(
+                                       std::chrono::microseconds(100));
+                                     ++done;
+                                 }),
+                                 xdispatch::queue_priority::DEFAULT);
+            latencies.push_back(std::chrono::steady_clock::now() - start);
+        }
+        while (done < kBURST) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](size_t p) {
+        const auto index = std::min(latencies.size() * p / 100,
+                                    latencies.size() - 1);
+        return static_cast<int>(latencies[index].count());
+    };
+    MU_MESSAGE("execute() p50 %i nsec, p99 %i nsec, max %i nsec",
+               percentile(50),
+               percentile(99),
+               percentile(100));
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+naive_threadpool_config(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_config);
+
+    xdispatch::naive::threadpool_config config;
+    config.min_threads = 1;
+    config.max_threads = 2;
+    config.affinity = { 0 };
+    auto pool = xdispatch::naive::create_threadpool(config);
+    auto queue = xdispatch::naive::create_parallel_queue(
+      "naive_threadpool_config", pool, xdispatch::queue_priority::DEFAULT);
+
+    // no more than the maximum number of threads may run at once
+    constexpr int kOPERATIONS = 20;
+    std::atomic<int> running(0);
+    std::atomic<int> max_running(0);
+    std::atomic<int> pinned(0);
+    std::atomic<int> done(0);
+    for (int i = 0; i < kOPERATIONS; ++i) {
+        queue.async([&] {
+            const auto now = ++running;
+            auto max = max_running.load();
+            while (now > max && !max_running.compare_exchange_weak(max, now)) {
+            }
+#if (defined XDISPATCH2_HAVE_PTHREAD_SETAFFINITY_NP)
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            const auto err =
+              pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+            if (0 == err && 1 == CPU_COUNT(&set) && CPU_ISSET(0, &set)) {
+                ++pinned;
+            }
+#else
+            ++pinned;
+#endif
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --running;
+            ++done;
+        });
+    }
+    while (done < kOPERATIONS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_LESS_THAN(max_running.load(), 3);
+    MU_ASSERT_EQUAL(pinned.load(), kOPERATIONS);
+
+    // serial queues may target the pool as well
+    auto serial = xdispatch::naive::create_serial_queue(
+      "naive_threadpool_config", pool, xdispatch::queue_priority::DEFAULT);
+    std::atomic<bool> serial_done(false);
+    serial.async([&serial_done] { serial_done = true; });
+    while (!serial_done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    MU_PASS("Pool was bounded and pinned");
+    MU_END_TEST;
+}
+
+void
+naive_threadpool_producers(void*)
+{
+    MU_BEGIN_TEST(naive_threadpool_producers);
+
+    constexpr int kPOOLS = 8;
+    constexpr int kOPERATIONS = 100;
+    std::atomic<int> executed(0);
+    const auto submit = [&executed](xdispatch::naive::ithreadpool& pool) {
+        for (int i = 0; i < kOPERATIONS; ++i) {
+            pool.execute_unique(
+              xdispatch::unique_operation([&executed] { ++executed; }),
+              xdispatch::queue_priority::DEFAULT);
+        }
+    };
+    const auto wait_for = [&executed](int count) {
+        while (executed < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // pools ending while the threads queueing to them keep running
+    std::thread producer([&] {
+        for (int p = 0; p < kPOOLS; ++p) {
+            xdispatch::naive::threadpool_config config;
+            config.max_threads = 2;
+            auto pool = xdispatch::naive::create_threadpool(config);
+            submit(*pool);
+            wait_for((p + 1) * kOPERATIONS);
+        }
+    });
+    producer.join();
+    MU_ASSERT_EQUAL(executed.load(), kPOOLS * kOPERATIONS);
+
+    // threads ending while the pool they queued to keeps running
+    xdispatch::naive::threadpool_config config;
+    config.max_threads = 2;
+    auto pool = xdispatch::naive::create_threadpool(config);
+    for (int p = 0; p < kPOOLS; ++p) {
+        std::thread([&] { submit(*pool); }).join();
+    }
+    submit(*pool);
+    wait_for((2 * kPOOLS + 1) * kOPERATIONS);
+    MU_ASSERT_EQUAL(executed.load(), (2 * kPOOLS + 1) * kOPERATIONS);
+
+    MU_PASS("Producers outlived pools and the other way round");
+    MU_END_TEST;
+}
+
+void
+naive_numa_threadpool(void*)
+{
+    MU_BEGIN_TEST(naive_numa_threadpool);
+
+    xdispatch::naive::threadpool_config config;
+    config.numa = true;
+    const auto pool = std::dynamic_pointer_cast<
+      xdispatch::naive::numa_threadpool>(
+      xdispatch::naive::create_threadpool(config));
+    MU_ASSERT_NOT_NULL(pool.get());
+    MU_ASSERT_GREATER_THAN(pool->node_count(), 0);
+    MU_MESSAGE("Running on %i nodes", static_cast<int>(pool->node_count()));
+
+    const auto is_node = [&pool](xdispatch::naive::ithreadpool* current) {
+        for (size_t i = 0; i < pool->node_count(); ++i) {
+            if (pool->node(i).get() == current) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // work submitted from a node is executed on the same node
+    // unless all of its workers are busy
+    auto queue = xdispatch::naive::create_parallel_queue(
+      "naive_numa_threadpool", pool, xdispatch::queue_priority::DEFAULT);
+    constexpr int kOPERATIONS = 100;
+    std::atomic<int> on_node(0);
+    std::atomic<int> same_node(0);
+    std::atomic<int> done(0);
+    for (int i = 0; i < kOPERATIONS; ++i) {
+        queue.async([&] {
+            auto* const submitter = xdispatch::naive::ithreadpool::current();
+            if (is_node(submitter)) {
+                ++on_node;
+            }
+            queue.async([&, submitter] {
+                if (xdispatch::naive::ithreadpool::current() == submitter) {
+                    ++same_node;
+                }
+                ++done;
+            });
+        });
+    }
+    while (done < kOPERATIONS) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_EQUAL(on_node.load(), kOPERATIONS);
+    MU_MESSAGE("%i of %i operations stayed on their node",
+               same_node.load(),
+               kOPERATIONS);
+    if (1 == pool->node_count()) {
+        MU_ASSERT_EQUAL(same_node.load(), kOPERATIONS);
+    }
+
+    // a serial queue may prefer a node by running on its pool
+    const auto preferred = pool->node(pool->node_count() - 1);
+    auto serial = xdispatch::naive::create_serial_queue(
+      "naive_numa_threadpool", preferred, xdispatch::queue_priority::DEFAULT);
+    std::atomic<xdispatch::naive::ithreadpool*> serial_pool(nullptr);
+    serial.async([&serial_pool] {
+        serial_pool = xdispatch::naive::ithreadpool::current();
+    });
+    while (!serial_pool) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_TRUE(is_node(serial_pool));
+    if (1 == pool->node_count()) {
+        MU_ASSERT_TRUE(serial_pool == preferred.get());
+    }
+
+    MU_PASS("Operations were kept on their node");
+    MU_END_TEST;
+}
+
+void
+naive_benchmark_numa(void*)
+{
+    MU_BEGIN_TEST(naive_benchmark_numa);
+
+    // each chain touches a buffer first and then has it read a number
+    // of times by operations submitted from the operation touching it,
+    // these can read from local memory only when kept on the same node
+    constexpr int kCHAINS = 64;
+    constexpr int kREADS = 8;
+    constexpr size_t kBUFFER = 1 << 17;
+    using buffer = std::vector<uint64_t>;
+
+    for (const bool numa : { false, true }) {
+        xdispatch::naive::threadpool_config config;
+        config.numa = numa;
+        auto pool = xdispatch::naive::create_threadpool(config);
+        auto queue = xdispatch::naive::create_parallel_queue(
+          "naive_benchmark_numa", pool, xdispatch::queue_priority::DEFAULT);
+
+        std::atomic<int> done(0);
+        std::atomic<uint64_t> sum(0);
+        Stopwatch watch;
+        watch.start();
+        for (int chain = 0; chain < kCHAINS; ++chain) {
+            queue.async([&] {
+                auto data = std::make_shared<buffer>(kBUFFER);
+                for (size_t i = 0; i < kBUFFER; ++i) {
+                    (*data)[i] = i;
+                }
+                for (int read = 0; read < kREADS; ++read) {
+                    queue.async([&, data] {
+                        uint64_t local = 0;
+                        for (const auto value : *data) {
+                            local += value;
+                        }
+                        sum += local;
+                        ++done;
+                    });
+                }
+            });
+        }
+        while (done < kCHAINS * kREADS) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        watch.stop();
+
+        const auto bytes = static_cast<uint64_t>(kCHAINS) * (kREADS + 1) *
+                           kBUFFER * sizeof(uint64_t);
+        const auto usec = std::max<uint64_t>(1, watch.elapsed().count());
+        MU_MESSAGE("%-6s %i MB/s",
+                   numa ? "numa" : "shared",
+                   static_cast<int>(bytes / usec));
+        MU_ASSERT_GREATER_THAN(sum.load(), 0);
+    }
+
+    MU_PASS("Test completed");
+    MU_END_TEST;
+}
+
+void
+naive_serial_queue_drain_budget(void*)
+{
+    MU_BEGIN_TEST(naive_serial_queue_drain_budget);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    auto queue =
+      xdispatch::naive::create_serial_queue("naive_drain_budget", pool);
+
+    const auto defaults = xdispatch::naive::drain_budget(queue);
+    MU_ASSERT_EQUAL(defaults.duration.count(), 200);
+    MU_ASSERT_GREATER_THAN(defaults.operations, 0);
+
+    const auto flood = [&queue](int count) {
+        std::atomic<int> done(0);
+        for (int i = 0; i < count; ++i) {
+            queue.async([&done] { ++done; });
+        }
+        while (done < count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    // micro tasks should be drained in large batches
+    constexpr int kMICRO = 20000;
+    flood(kMICRO);
+    const auto micro = xdispatch::naive::statistics(queue);
+    MU_MESSAGE("%i micro tasks: %i drains, %i yields, %i per drain",
+               kMICRO,
+               static_cast<int>(micro.drains),
+               static_cast<int>(micro.yields),
+               static_cast<int>(micro.operations_per_drain));
+    MU_ASSERT_GREATER_THAN(micro.drains, 0);
+    MU_ASSERT_LESS_THAN(micro.yields, kMICRO / 100);
+    MU_ASSERT_GREATER_THAN(micro.operations_per_drain, 10);
+
+    // a tight budget makes the queue drain each operation on its own
+    xdispatch::naive::serial_queue_drain_budget budget;
+    budget.operations = 1;
+    xdispatch::naive::drain_budget(queue, budget);
+    MU_ASSERT_EQUAL(xdispatch::naive::drain_budget(queue).operations, 1);
+
+    constexpr int kTIGHT = 100;
+    flood(kTIGHT);
+    const auto tight = xdispatch::naive::statistics(queue);
+    MU_ASSERT_EQUAL(tight.operations_per_drain, 1);
+    MU_ASSERT_EQUAL(tight.drains - micro.drains, kTIGHT);
+
+    MU_PASS("Drain budget adapted");
+    MU_END_TEST;
+}
+
+void
+naive_timer_cancel_release(void*)
+{
+    MU_BEGIN_TEST(naive_timer_cancel_release);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    auto queue = xdispatch::naive::create_parallel_queue(
+      "naive_timer_cancel_release", pool, xdispatch::queue_priority::DEFAULT);
+
+    // a cancelled timer must not be kept alive until its deadline
+    auto token = std::make_shared<int>(42);
+    std::weak_ptr<int> released = token;
+    {
+        xdispatch::timer timer(std::chrono::seconds(60), queue);
+        timer.handler([token] { MU_FAIL("Cancelled timer fired"); });
+        timer.resume(std::chrono::seconds(60));
+        timer.cancel();
+    }
+    token.reset();
+    MU_ASSERT_TRUE(released.expired());
+
+    // the same applies to suspended timers
+    token = std::make_shared<int>(43);
+    released = token;
+    {
+        xdispatch::timer timer(std::chrono::seconds(60), queue);
+        timer.handler([token] { MU_FAIL("Suspended timer fired"); });
+        timer.resume(std::chrono::seconds(60));
+        timer.suspend();
+    }
+    token.reset();
+    MU_ASSERT_TRUE(released.expired());
+
+    MU_PASS("Timers released");
+    MU_END_TEST;
+}
+
+void
+naive_timer_coarse_singleshot(void*)
+{
+    MU_BEGIN_TEST(naive_timer_coarse_singleshot);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    auto queue = xdispatch::naive::create_parallel_queue(
+      "naive_timer_coarse_singleshot",
+      pool,
+      xdispatch::queue_priority::DEFAULT);
+
+    // the leeway of a coarse timer is limited by its delay so that
+    // a short singleshot timer is not late by up to a second
+    const std::chrono::milliseconds kDelay(50);
+    std::atomic<bool> fired(false);
+    xdispatch::timer timer(std::chrono::milliseconds(0), queue);
+    timer.latency(xdispatch::timer_precision::COARSE);
+    timer.handler([&fired] { fired = true; });
+    const auto start = std::chrono::steady_clock::now();
+    timer.resume(kDelay);
+    while (!fired &&
+           std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+    timer.cancel();
+    MU_MESSAGE("Fired after %i msec", static_cast<int>(elapsed.count()));
+    MU_ASSERT_TRUE(fired);
+    MU_ASSERT_GREATER_THAN_EQUAL(elapsed.count(), kDelay.count());
+    MU_ASSERT_LESS_THAN(elapsed.count(), kDelay.count() * 5);
+
+    MU_PASS("Coarse timer fired in time");
+    MU_END_TEST;
+}
+
+void
+naive_serial_queue_apply(void*)
+{
+    MU_BEGIN_TEST(naive_serial_queue_apply);
+
+    auto pool = std::make_shared<xdispatch::naive::threadpool>();
+    auto queue =
+      xdispatch::naive::create_serial_queue("naive_serial_queue_apply", pool);
+
+    constexpr int kTIMES = 100;
+    const auto caller = std::this_thread::get_id();
+    std::atomic<int> order(0);
+    std::atomic<bool> in_order(true);
+    std::atomic<bool> on_caller(true);
+    const auto iteration = [&](size_t i) {
+        if (static_cast<int>(i) != order++ % kTIMES) {
+            in_order = false;
+        }
+        if (std::this_thread::get_id() != caller) {
+            on_caller = false;
+        }
+    };
+
+    // an idle queue executes the iterations right away
+    queue.apply(kTIMES, iteration);
+    MU_ASSERT_EQUAL(order, kTIMES);
+    MU_ASSERT_TRUE(in_order);
+    MU_ASSERT_TRUE(on_caller);
+
+    // applying from within the queue itself must not deadlock
+    std::atomic<bool> nested(false);
+    std::atomic<bool> queued_after(false);
+    queue.async([&] {
+        queue.async([&] { queued_after = (order == 3 * kTIMES); });
+        queue.apply(kTIMES, [&](size_t i) { iteration(i); });
+        queue.apply(kTIMES, [&](size_t i) { iteration(i); });
+        nested = true;
+    });
+    while (!queued_after) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_TRUE(nested);
+    MU_ASSERT_TRUE(in_order);
+
+    // a busy queue executes them once the jobs before completed
+    std::atomic<bool> busy_done(false);
+    queue.async([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        busy_done = true;
+    });
+    queue.apply(kTIMES, [&](size_t) { MU_ASSERT_TRUE(busy_done); });
+
+    MU_PASS("Iterations executed");
+    MU_END_TEST;
+}
+
+void
+naive_socket_notifier_trigger(void*)
+{
+    MU_BEGIN_TEST(naive_socket_notifier_trigger);
+
+    constexpr int kPACKET = 16;
+    std::vector<char> buffer(kPACKET);
+
+    // handlers only consume a single byte per invocation
+    const auto consume_one = [](std::atomic<int>& calls) {
+        return [&calls](xdispatch::socket_t socket, xdispatch::notifier_type) {
+            char c = 0;
+            MU_ASSERT_EQUAL(read(socket, &c, 1), 1);
+            ++calls;
+        };
+    };
+    const auto wait_for = [](const std::atomic<int>& calls, int expected) {
+        for (int i = 0; i < 1000 && calls < expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        // give surplus invocations a chance to show up
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    };
+
+    // a level-triggered notifier fires for as long as data is pending
+    int level_fds[2] = { -1 };
+    MU_ASSERT_NOT_EQUAL(platform_socketpair(level_fds), -1);
+    std::atomic<int> level_calls(0);
+    auto level = xdispatch::naive::create_socket_notifier(
+      level_fds[1],
+      xdispatch::notifier_type::READ,
+      xdispatch::naive::notifier_trigger::LEVEL);
+    level.handler(consume_one(level_calls));
+    level.resume();
+    MU_ASSERT_EQUAL(kPACKET, write(level_fds[0], buffer.data(), kPACKET));
+    wait_for(level_calls, kPACKET);
+    MU_ASSERT_EQUAL(level_calls.load(), kPACKET);
+    level.cancel();
+
+#if (defined XDISPATCH2_HAVE_EPOLL)
+    // an edge-triggered notifier fires once per arriving data
+    int edge_fds[2] = { -1 };
+    MU_ASSERT_NOT_EQUAL(platform_socketpair(edge_fds), -1);
+    std::atomic<int> edge_calls(0);
+    auto edge = xdispatch::naive::create_socket_notifier(
+      edge_fds[1],
+      xdispatch::notifier_type::READ,
+      xdispatch::naive::notifier_trigger::EDGE);
+    edge.handler(consume_one(edge_calls));
+    edge.resume();
+    MU_ASSERT_EQUAL(kPACKET, write(edge_fds[0], buffer.data(), kPACKET));
+    wait_for(edge_calls, 1);
+    MU_ASSERT_EQUAL(edge_calls.load(), 1);
+    MU_ASSERT_EQUAL(kPACKET, write(edge_fds[0], buffer.data(), kPACKET));
+    wait_for(edge_calls, 2);
+    MU_ASSERT_EQUAL(edge_calls.load(), 2);
+    edge.cancel();
+#endif
+
+    MU_PASS("Triggers work");
+    MU_END_TEST;
+}
+
+void
+naive_socket_notifier_resume_in_handler(void*)
+{
+    MU_BEGIN_TEST(naive_socket_notifier_resume_in_handler);
+
+    constexpr int kPACKETS = 3;
+    constexpr int kPACKET = 16;
+    std::vector<char> buffer(kPACKET);
+
+    // handlers suspend the notifier while servicing the socket and
+    // resume it once done, as coroutines awaiting it repeatedly do
+    for (const auto trigger : { xdispatch::naive::notifier_trigger::LEVEL,
+                                xdispatch::naive::notifier_trigger::EDGE }) {
+        int fds[2] = { -1 };
+        MU_ASSERT_NOT_EQUAL(platform_socketpair(fds), -1);
+        std::atomic<int> calls(0);
+        auto notifier = xdispatch::naive::create_socket_notifier(
+          fds[1], xdispatch::notifier_type::READ, trigger);
+        auto* const suspendable = &notifier;
+        notifier.handler(
+          [&calls, suspendable](xdispatch::socket_t socket,
+                                xdispatch::notifier_type) {
+              suspendable->suspend();
+              std::vector<char> data(kPACKET);
+              MU_ASSERT_EQUAL(read(socket, data.data(), kPACKET), kPACKET);
+              ++calls;
+              suspendable->resume();
+          });
+        notifier.resume();
+
+        for (int i = 1; i <= kPACKETS; ++i) {
+            MU_ASSERT_EQUAL(kPACKET, write(fds[0], buffer.data(), kPACKET));
+            for (int wait = 0; wait < 1000 && calls < i; ++wait) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            MU_ASSERT_EQUAL(calls.load(), i);
+        }
+        notifier.cancel();
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    MU_PASS("Notifiers armed again");
+    MU_END_TEST;
+}
+
+void
+naive_socket_notifier_many(void*)
+{
+    MU_BEGIN_TEST(naive_socket_notifier_many);
+
+    // every active notifier used to occupy a thread of its own
+    constexpr int kSOCKETS = 200;
+    std::atomic<int> ready(0);
+    std::vector<xdispatch::socket_t> fds(2 * kSOCKETS, -1);
+    std::vector<xdispatch::socket_notifier> notifiers;
+    for (int i = 0; i < kSOCKETS; ++i) {
+        MU_ASSERT_NOT_EQUAL(platform_socketpair(&fds[2 * i]), -1);
+        notifiers.emplace_back(fds[2 * i + 1], xdispatch::notifier_type::READ);
+        notifiers.back().handler(
+          [&ready](xdispatch::socket_t socket, xdispatch::notifier_type) {
+              char c = 0;
+              MU_ASSERT_EQUAL(read(socket, &c, 1), 1);
+              ++ready;
+          });
+        notifiers.back().resume();
+    }
+
+    const char c = 0;
+    for (int i = 0; i < kSOCKETS; ++i) {
+        MU_ASSERT_EQUAL(write(fds[2 * i], &c, 1), 1);
+    }
+    for (int i = 0; i < 5000 && ready < kSOCKETS; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    MU_ASSERT_EQUAL(ready.load(), kSOCKETS);
+
+    for (auto& notifier : notifiers) {
+        notifier.cancel();
+    }
+
+    MU_PASS("All notifiers fired");
+    MU_END_TEST;
+}
+
+static void
+naive_io_roundtrip(const xdispatch::queue& queue)
+{
+    int fds[2] = { -1 };
+    MU_ASSERT_NOT_EQUAL(platform_socketpair(fds), -1);
+
+    const auto wait_for = [](const std::atomic<bool>& done) {
+        for (int i = 0; i < 5000 && !done; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        MU_ASSERT_TRUE(done);
+    };
+
+    // a pending read completes once data arrives
+    static const char kMESSAGE[] = "xdispatch2";
+    constexpr auto kLENGTH = sizeof(kMESSAGE);
+    xdispatch::naive::io_buffer registered(64);
+    MU_MESSAGE("registered buffer: %i",
+               static_cast<int>(registered.registered()));
+    std::atomic<bool> read_done(false);
+    xdispatch::naive::async_read(
+      queue,
+      fds[1],
+      registered.data(),
+      registered.size(),
+      [&](xdispatch::naive::io_result result) {
+          MU_ASSERT_EQUAL(result.error, 0);
+          MU_ASSERT_EQUAL(result.value, static_cast<int64_t>(kLENGTH));
+          MU_ASSERT_EQUAL(0, memcmp(registered.data(), kMESSAGE, kLENGTH));
+          read_done = true;
+      });
+    std::atomic<bool> write_done(false);
+    xdispatch::naive::async_write(
+      queue,
+      fds[0],
+      kMESSAGE,
+      kLENGTH,
+      [&](xdispatch::naive::io_result result) {
+          MU_ASSERT_EQUAL(result.error, 0);
+          MU_ASSERT_EQUAL(result.value, static_cast<int64_t>(kLENGTH));
+          write_done = true;
+      });
+    wait_for(write_done);
+    wait_for(read_done);
+
+    // plain memory works the same
+    std::vector<char> plain(64);
+    read_done = false;
+    MU_ASSERT_EQUAL(kLENGTH, write(fds[0], kMESSAGE, kLENGTH));
+    xdispatch::naive::async_read(
+      queue,
+      fds[1],
+      plain.data(),
+      plain.size(),
+      [&](xdispatch::naive::io_result result) {
+          MU_ASSERT_EQUAL(result.value, static_cast<int64_t>(kLENGTH));
+          MU_ASSERT_EQUAL(0, memcmp(plain.data(), kMESSAGE, kLENGTH));
+          read_done = true;
+      });
+    wait_for(read_done);
+
+#if (defined XDISPATCH2_HAVE_SOCKETPAIR)
+    // accepts a connection made to a listening socket
+    const auto listener = socket(AF_INET, SOCK_STREAM, 0);
+    MU_ASSERT_TRUE(listener >= 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t address_length = sizeof(address);
+    auto* generic = reinterpret_cast<sockaddr*>(&address);
+    MU_ASSERT_EQUAL(0, bind(listener, generic, address_length));
+    MU_ASSERT_EQUAL(0, getsockname(listener, generic, &address_length));
+    MU_ASSERT_EQUAL(0, listen(listener, 1));
+
+    std::atomic<bool> accept_done(false);
+    xdispatch::naive::async_accept(
+      queue, listener, [&](xdispatch::naive::io_result result) {
+          MU_ASSERT_EQUAL(result.error, 0);
+          MU_ASSERT_TRUE(result.value >= 0);
+          close(static_cast<int>(result.value));
+          accept_done = true;
+      });
+    const auto client = socket(AF_INET, SOCK_STREAM, 0);
+    MU_ASSERT_EQUAL(0, connect(client, generic, address_length));
+    wait_for(accept_done);
+    close(client);
+    close(listener);
+#endif
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void
+naive_io_completions(void*)
+{
+    MU_BEGIN_TEST(naive_io_completions);
+
+    xdispatch::queue queue("naive_io_completions");
+    MU_MESSAGE("io_uring available: %i",
+               static_cast<int>(xdispatch::naive::io_uring_enabled()));
+    naive_io_roundtrip(queue);
+
+    // the same requests served by waiting for readiness
+    xdispatch::naive::io_uring_enabled(false);
+    MU_ASSERT_TRUE(!xdispatch::naive::io_uring_enabled());
+    naive_io_roundtrip(queue);
+    xdispatch::naive::io_uring_enabled(true);
+
+    MU_PASS("Requests completed");
+    MU_END_TEST;
+}
+
+void
+register_naive_tests()
+{
+    MU_REGISTER_TEST(naive_threadpool_weights);
+    MU_REGISTER_TEST(naive_threadpool_weights_zero);
+    MU_REGISTER_TEST(naive_threadpool_wake);
+    MU_REGISTER_TEST(naive_threadpool_park_policy);
+    MU_REGISTER_TEST(naive_benchmark_park_policy);
+    MU_REGISTER_TEST(naive_benchmark_execute_latency);
+    MU_REGISTER_TEST(naive_threadpool_config);
+    MU_REGISTER_TEST(naive_threadpool_producers);
+    MU_REGISTER_TEST(naive_numa_threadpool);
+    MU_REGISTER_TEST(naive_benchmark_numa);
+    MU_REGISTER_TEST(naive_serial_queue_drain_budget);
+    MU_REGISTER_TEST(naive_serial_queue_apply);
+    MU_REGISTER_TEST(naive_timer_cancel_release);
+    MU_REGISTER_TEST(naive_timer_coarse_singleshot);
+    MU_REGISTER_TEST(naive_socket_notifier_trigger);
+    MU_REGISTER_TEST(naive_socket_notifier_resume_in_handler);
+    MU_REGISTER_TEST(naive_socket_notifier_many);
+    MU_REGISTER_TEST(naive_io_completions);
+}
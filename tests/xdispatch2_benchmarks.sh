@@ -50,9 +50,118 @@ ${TESTS} -n naive__cxx_benchmark_global_queue
 ${TESTS} -n qt5__cxx_benchmark_global_queue
 echo ""
 
+echo "BENCHMARK SERIAL QUEUES (LAMBDAS)"
+echo "================================="
+${TESTS} -n libdispatch__cxx_benchmark_serial_queue_lambda
+${TESTS} -n naive__cxx_benchmark_serial_queue_lambda
+${TESTS} -n qt5__cxx_benchmark_serial_queue_lambda
+echo ""
+
+echo "BENCHMARK GLOBAL QUEUES (LAMBDAS)"
+echo "================================="
+${TESTS} -n libdispatch__cxx_benchmark_global_queue_lambda
+${TESTS} -n naive__cxx_benchmark_global_queue_lambda
+${TESTS} -n qt5__cxx_benchmark_global_queue_lambda
+echo ""
+
+echo "BENCHMARK GLOBAL QUEUES (LAMBDAS, NO POOLING)"
+echo "============================================="
+XDISPATCH2_OPERATION_POOLING=0 ${TESTS} -n naive__cxx_benchmark_global_queue_lambda
+echo ""
+
+echo "BENCHMARK SERIAL QUEUES (BULK)"
+echo "=============================="
+${TESTS} -n libdispatch__cxx_benchmark_serial_queue_bulk
+${TESTS} -n naive__cxx_benchmark_serial_queue_bulk
+${TESTS} -n qt5__cxx_benchmark_serial_queue_bulk
+echo ""
+
+echo "BENCHMARK GLOBAL QUEUES (BULK)"
+echo "=============================="
+${TESTS} -n libdispatch__cxx_benchmark_global_queue_bulk
+${TESTS} -n naive__cxx_benchmark_global_queue_bulk
+${TESTS} -n qt5__cxx_benchmark_global_queue_bulk
+echo ""
+
+echo "BENCHMARK GLOBAL QUEUES (1, 8, 64 PRODUCERS)"
+echo "============================================"
+${TESTS} -n libdispatch__cxx_benchmark_global_queue_producers
+${TESTS} -n naive__cxx_benchmark_global_queue_producers
+${TESTS} -n qt5__cxx_benchmark_global_queue_producers
+echo ""
+
+echo "BENCHMARK SERIAL QUEUES (SELF POSTING)"
+echo "======================================"
+${TESTS} -n libdispatch__cxx_benchmark_serial_queue_self_post
+${TESTS} -n naive__cxx_benchmark_serial_queue_self_post
+${TESTS} -n qt5__cxx_benchmark_serial_queue_self_post
+echo ""
+
+echo "BENCHMARK COROUTINES (SCHEDULE)"
+echo "==============================="
+${TESTS} -n libdispatch__cxx_benchmark_coroutine_schedule
+${TESTS} -n naive__cxx_benchmark_coroutine_schedule
+${TESTS} -n qt5__cxx_benchmark_coroutine_schedule
+echo ""
+
+echo "BENCHMARK FUTURES (THEN)"
+echo "========================"
+${TESTS} -n libdispatch__cxx_benchmark_future_then
+${TESTS} -n naive__cxx_benchmark_future_then
+${TESTS} -n qt5__cxx_benchmark_future_then
+echo ""
+
 echo "BENCHMARK GROUPS"
 echo "================"
 ${TESTS} -n libdispatch__cxx_benchmark_group
 ${TESTS} -n naive__cxx_benchmark_group
 ${TESTS} -n qt5__cxx_benchmark_group
 echo ""
+
+echo "BENCHMARK 10K CONCURRENT GROUPS"
+echo "==============================="
+${TESTS} -n libdispatch__cxx_benchmark_group_concurrent
+${TESTS} -n naive__cxx_benchmark_group_concurrent
+${TESTS} -n qt5__cxx_benchmark_group_concurrent
+echo ""
+
+echo "BENCHMARK FORK JOIN"
+echo "==================="
+${TESTS} -n libdispatch__cxx_benchmark_fork_join
+${TESTS} -n naive__cxx_benchmark_fork_join
+${TESTS} -n qt5__cxx_benchmark_fork_join
+echo ""
+
+echo "BENCHMARK FORK JOIN (NO POOLING)"
+echo "================================"
+XDISPATCH2_OPERATION_POOLING=0 ${TESTS} -n naive__cxx_benchmark_fork_join
+echo ""
+
+echo "BENCHMARK APPLY"
+echo "==============="
+${TESTS} -n libdispatch__cxx_benchmark_apply
+${TESTS} -n naive__cxx_benchmark_apply
+${TESTS} -n qt5__cxx_benchmark_apply
+echo ""
+
+echo "BENCHMARK NESTED APPLY"
+echo "======================"
+${TESTS} -n libdispatch__cxx_benchmark_apply_nested
+${TESTS} -n naive__cxx_benchmark_apply_nested
+${TESTS} -n qt5__cxx_benchmark_apply_nested
+echo ""
+
+echo "BENCHMARK PARK POLICY"
+echo "====================="
+${TESTS} -n naive_benchmark_park_policy
+echo ""
+
+echo "BENCHMARK EXECUTE LATENCY"
+echo "========================="
+${TESTS} -n naive_benchmark_execute_latency
+echo ""
+
+echo "BENCHMARK NUMA"
+echo "=============="
+${TESTS} -n naive_benchmark_numa
+echo ""